@@ -0,0 +1,58 @@
+/*
+ File: BackupThread.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <BackupThread.h>
+#include <DatabaseUtils.h>
+
+//---------------------------------------------------------------
+BackupThread::BackupThread(const std::filesystem::path &database, bool verify, QObject *parent)
+: QThread(parent)
+, m_database{database}
+, m_backup{backupFileName(database)}
+, m_verify{verify}
+, m_abort{false}
+, m_copied{0}
+, m_total{0}
+{
+}
+
+//---------------------------------------------------------------
+void BackupThread::run()
+{
+  auto progress = [this](int copied, int total)
+  {
+    m_copied = copied;
+    m_total = total;
+    return !m_abort;
+  };
+
+  try
+  {
+    copyDatabase(m_database, m_backup, m_verify, progress, m_error);
+  }
+  catch(const std::exception &e)
+  {
+    m_error = QString("Exception: %1").arg(QString::fromLatin1(e.what()));
+  }
+  catch(...)
+  {
+    m_error = QString("Unknown exception");
+  }
+}
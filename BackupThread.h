@@ -0,0 +1,103 @@
+/*
+ File: BackupThread.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BACKUPTHREAD_H_
+#define BACKUPTHREAD_H_
+
+// Qt
+#include <QThread>
+#include <QString>
+
+// C++
+#include <atomic>
+#include <filesystem>
+
+/** \class BackupThread
+ * \brief Thread to copy the database before modifying it.
+ *
+ */
+class BackupThread
+: public QThread
+{
+    Q_OBJECT
+  public:
+    /** \brief BackupThread class constructor.
+     * \param[in] database Database file path.
+     * \param[in] verify True to verify the copy.
+     * \param[in] parent Raw pointer of the parent QObject.
+     *
+     */
+    explicit BackupThread(const std::filesystem::path &database, bool verify, QObject *parent = nullptr);
+
+    /** \brief BackupThread class virtual destructor.
+     *
+     */
+    virtual ~BackupThread()
+    {};
+
+    /** \brief Aborts the copy if running, the partial copy is removed.
+     *
+     */
+    void abort()
+    { m_abort = true; }
+
+    /** \brief Returns the error text or empty if none.
+     *
+     */
+    QString error() const
+    { return m_error; }
+
+    /** \brief Returns the path of the database.
+     *
+     */
+    const std::filesystem::path &database() const
+    { return m_database; }
+
+    /** \brief Returns the path of the copy.
+     *
+     */
+    const std::filesystem::path &backup() const
+    { return m_backup; }
+
+    /** \brief Returns the number of copied pages. Can be called from any thread.
+     *
+     */
+    int copiedPages() const
+    { return m_copied; }
+
+    /** \brief Returns the total number of pages, 0 if not yet known. Can be called from any thread.
+     *
+     */
+    int totalPages() const
+    { return m_total; }
+
+  protected:
+    virtual void run();
+
+  private:
+    const std::filesystem::path m_database; /** database file path. */
+    const std::filesystem::path m_backup;   /** backup file path. */
+    const bool                  m_verify;   /** true to verify the copy. */
+    QString                     m_error;    /** error message or empty if none. */
+    std::atomic<bool>           m_abort;    /** true to stop the copy. */
+    std::atomic<int>            m_copied;   /** number of copied pages. */
+    std::atomic<int>            m_total;    /** total number of pages. */
+};
+
+#endif // BACKUPTHREAD_H_
@@ -0,0 +1,121 @@
+/*
+ File: BatchWriter.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <BatchWriter.h>
+
+// C++
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+//---------------------------------------------------------------
+BatchWriter::BatchWriter(sqlite3 *db, unsigned long maxRows, unsigned long maxBytes)
+: m_sql3Handle{db}
+, m_maxRows{maxRows}
+, m_maxBytes{maxBytes}
+, m_open{false}
+, m_totalLatency{0}
+, m_maxLatency{0}
+{
+  assert(m_sql3Handle);
+}
+
+//---------------------------------------------------------------
+BatchWriter::~BatchWriter()
+{
+  commit();
+}
+
+//---------------------------------------------------------------
+bool BatchWriter::begin()
+{
+  if(m_open) return true;
+
+  m_open = execute("BEGIN IMMEDIATE TRANSACTION");
+  m_current.rows = m_current.bytes = 0;
+
+  return m_open;
+}
+
+//---------------------------------------------------------------
+bool BatchWriter::rowWritten(unsigned long bytes)
+{
+  ++m_current.rows;
+  m_current.bytes += bytes;
+
+  const bool rowsLimit = m_maxRows != 0 && m_current.rows >= m_maxRows;
+  const bool bytesLimit = m_maxBytes != 0 && m_current.bytes >= m_maxBytes;
+
+  if(rowsLimit || bytesLimit)
+  {
+    return commit();
+  }
+
+  return false;
+}
+
+//---------------------------------------------------------------
+bool BatchWriter::commit()
+{
+  if(!m_open) return true;
+
+  // The changes that can't be prepared for the commit are discarded.
+  QString error;
+  if(m_beforeCommit && !m_beforeCommit(error))
+  {
+    execute("ROLLBACK TRANSACTION");
+    m_open = false;
+    m_current = BatchInformation();
+    m_error = error;
+    return false;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto result = execute("COMMIT TRANSACTION");
+  const auto latency = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  // On failure SQLite may have already rolled back the transaction, check if it's still open.
+  m_open = !result && sqlite3_get_autocommit(m_sql3Handle) == 0;
+  if(!result) return false;
+
+  m_current.latency = latency;
+  m_current.number = m_last.number + 1;
+  m_last = m_current;
+  m_current = BatchInformation();
+
+  m_totalLatency += latency;
+  m_maxLatency = std::max(m_maxLatency, latency);
+
+  return true;
+}
+
+//---------------------------------------------------------------
+bool BatchWriter::execute(const char *sql)
+{
+  const auto result = sqlite3_exec(m_sql3Handle, sql, nullptr, nullptr, nullptr);
+  if(result != SQLITE_OK)
+  {
+    m_error = QString("Unable to execute '%1'. SQLite3 error: %2").arg(QString::fromLatin1(sql))
+                .arg(QString::fromLatin1(sqlite3_errstr(result)));
+    return false;
+  }
+
+  return true;
+}
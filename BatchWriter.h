@@ -0,0 +1,153 @@
+/*
+ File: BatchWriter.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHWRITER_H_
+#define BATCHWRITER_H_
+
+// Qt
+#include <QString>
+
+// SQLite3
+#include <sqlite3/sqlite3.h>
+
+// C++
+#include <functional>
+
+/** \struct BatchInformation
+ * \brief Contains the information of a committed batch of write operations.
+ *
+ */
+struct BatchInformation
+{
+    unsigned long number;  /** batch sequential number, starting at 1. */
+    unsigned long rows;    /** number of write operations in the batch. */
+    unsigned long bytes;   /** approximate size of the data bound in the batch operations. */
+    double        latency; /** time spent in the COMMIT in milliseconds. */
+
+    BatchInformation()
+    : number{0}
+    , rows{0}
+    , bytes{0}
+    , latency{0}
+    {};
+};
+
+/** \brief Callback executed before committing a transaction. Returns true to commit it, or false
+ * and the error message to roll it back.
+ *
+ */
+using BeforeCommit = std::function<bool(QString &error)>;
+
+/** \class BatchWriter
+ * \brief Groups write operations in explicit transactions, committing each time
+ *  the configured number of rows or bytes is reached.
+ *
+ */
+class BatchWriter
+{
+  public:
+    /** \brief BatchWriter class constructor.
+     * \param[in] db SQLite db handle.
+     * \param[in] maxRows Maximum number of rows per transaction, 0 for no limit.
+     * \param[in] maxBytes Maximum number of bytes per transaction, 0 for no limit.
+     *
+     */
+    explicit BatchWriter(sqlite3 *db, unsigned long maxRows, unsigned long maxBytes);
+
+    /** \brief BatchWriter class destructor. Commits the pending transaction, if any.
+     *
+     */
+    ~BatchWriter();
+
+    /** \brief Opens a transaction if there isn't one already open. Returns true
+     * on success and false otherwise.
+     *
+     */
+    bool begin();
+
+    /** \brief Accounts a written row in the current batch and commits the transaction if a
+     * batch boundary has been reached. Returns true if the batch has been committed.
+     * \param[in] bytes Approximate size of the data written.
+     *
+     */
+    bool rowWritten(unsigned long bytes);
+
+    /** \brief Commits the current transaction if there is one. Returns true on success
+     * and false otherwise.
+     *
+     */
+    bool commit();
+
+    /** \brief Sets the callback executed before each commit.
+     * \param[in] callback Callback or empty for none.
+     *
+     */
+    void setBeforeCommit(const BeforeCommit &callback)
+    { m_beforeCommit = callback; }
+
+    /** \brief Returns the information of the last committed batch.
+     *
+     */
+    const BatchInformation &lastBatch() const
+    { return m_last; }
+
+    /** \brief Returns the number of committed batches.
+     *
+     */
+    unsigned long batches() const
+    { return m_last.number; }
+
+    /** \brief Returns the total time spent committing in milliseconds.
+     *
+     */
+    double totalLatency() const
+    { return m_totalLatency; }
+
+    /** \brief Returns the maximum commit time in milliseconds.
+     *
+     */
+    double maximumLatency() const
+    { return m_maxLatency; }
+
+    /** \brief Returns the error text or empty if none.
+     *
+     */
+    QString error() const
+    { return m_error; }
+
+  private:
+    /** \brief Executes the given SQL statement. Returns true on success and false otherwise.
+     * \param[in] sql SQL statement text.
+     *
+     */
+    bool execute(const char *sql);
+
+    sqlite3         *m_sql3Handle;   /** SQLite db handle. */
+    unsigned long    m_maxRows;      /** maximum number of rows per transaction. */
+    unsigned long    m_maxBytes;     /** maximum number of bytes per transaction. */
+    bool             m_open;         /** true if a transaction is open, false otherwise. */
+    BatchInformation m_current;      /** information of the batch in progress. */
+    BatchInformation m_last;         /** information of the last committed batch. */
+    double           m_totalLatency; /** sum of commit times in milliseconds. */
+    double           m_maxLatency;   /** maximum commit time in milliseconds. */
+    BeforeCommit     m_beforeCommit; /** callback executed before each commit. */
+    QString          m_error;        /** error message or empty if none. */
+};
+
+#endif // BATCHWRITER_H_
@@ -0,0 +1,184 @@
+/*
+ File: BlurhashCache.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <BlurhashCache.h>
+
+// SQLite
+#include <sqlite3/sqlite3.h>
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#endif
+
+// The hash depends on the image contents and the working size, the number of components
+// is computed from the image size so it's not part of the key.
+const char *const CREATE_SQL = "CREATE TABLE IF NOT EXISTS Blurhashes (Path TEXT NOT NULL, Size INTEGER NOT NULL, "
+                               "WriteTime INTEGER NOT NULL, WorkSize INTEGER NOT NULL, Width INTEGER NOT NULL, "
+                               "Height INTEGER NOT NULL, Hash TEXT NOT NULL, PRIMARY KEY (Path, Size, WriteTime, WorkSize)) "
+                               "WITHOUT ROWID";
+const char *const FIND_SQL = "SELECT Width, Height, Hash FROM Blurhashes WHERE Path=?1 AND Size=?2 AND WriteTime=?3 AND WorkSize=?4";
+const char *const INSERT_SQL = "INSERT OR REPLACE INTO Blurhashes VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7)";
+
+//---------------------------------------------------------------
+BlurhashCache::BlurhashCache(const std::filesystem::path &file)
+: m_db{nullptr}
+, m_statementFind{nullptr}
+, m_statementInsert{nullptr}
+, m_hits{0}
+, m_misses{0}
+{
+  auto exec = [this](const char *sql)
+  {
+    const auto result = sqlite3_exec(m_db, sql, nullptr, nullptr, nullptr);
+    if(result != SQLITE_OK)
+      m_error = QString("Unable to initialize blurhash cache. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errmsg(m_db)));
+
+    return result == SQLITE_OK;
+  };
+
+  // The cache is in the user profile folder, its name can have any character and SQLite needs it in UTF-8.
+  if(sqlite3_open(QString::fromStdWString(file.wstring()).toUtf8().constData(), &m_db) != SQLITE_OK)
+  {
+    m_error = QString("Unable to open blurhash cache '%1'. SQLite3 error: %2").arg(QString::fromStdWString(file.wstring()))
+                .arg(QString::fromLatin1(sqlite3_errmsg(m_db)));
+    return;
+  }
+
+  // The cache can always be rebuilt, durability is not needed. All the new entries
+  // are written in a single transaction.
+  if(!exec(CREATE_SQL) || !exec("PRAGMA synchronous=OFF") || !exec("BEGIN")) return;
+
+  if(sqlite3_prepare_v2(m_db, FIND_SQL, -1, &m_statementFind, nullptr) != SQLITE_OK ||
+     sqlite3_prepare_v2(m_db, INSERT_SQL, -1, &m_statementInsert, nullptr) != SQLITE_OK)
+  {
+    m_error = QString("Unable to make blurhash cache statements. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errmsg(m_db)));
+    sqlite3_finalize(m_statementFind);
+    sqlite3_finalize(m_statementInsert);
+    m_statementFind = m_statementInsert = nullptr;
+  }
+}
+
+//---------------------------------------------------------------
+BlurhashCache::~BlurhashCache()
+{
+  sqlite3_finalize(m_statementFind);
+  sqlite3_finalize(m_statementInsert);
+
+  if(m_db)
+  {
+    if(sqlite3_get_autocommit(m_db) == 0)
+      sqlite3_exec(m_db, "COMMIT", nullptr, nullptr, nullptr);
+
+    sqlite3_close(m_db);
+  }
+}
+
+//---------------------------------------------------------------
+void BlurhashCache::bindKey(sqlite3_stmt *statement, const BlurhashKey &key)
+{
+  sqlite3_bind_text(statement, 1, key.path.c_str(), static_cast<int>(key.path.size()), SQLITE_TRANSIENT);
+  sqlite3_bind_int64(statement, 2, static_cast<sqlite3_int64>(key.size));
+  sqlite3_bind_int64(statement, 3, key.writeTime);
+  sqlite3_bind_int(statement, 4, key.workSize);
+}
+
+//---------------------------------------------------------------
+bool BlurhashCache::find(const BlurhashKey &key, BlurhashValue &value)
+{
+  bool found = false;
+
+  if(isValid())
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    bindKey(m_statementFind, key);
+    if(sqlite3_step(m_statementFind) == SQLITE_ROW)
+    {
+      value.width = sqlite3_column_int(m_statementFind, 0);
+      value.height = sqlite3_column_int(m_statementFind, 1);
+      const auto hash = reinterpret_cast<const char *>(sqlite3_column_text(m_statementFind, 2));
+      value.hash = hash ? std::string(hash, sqlite3_column_bytes(m_statementFind, 2)) : std::string();
+      found = !value.hash.empty();
+    }
+    sqlite3_reset(m_statementFind);
+  }
+
+  if(found) ++m_hits;
+  else      ++m_misses;
+
+  return found;
+}
+
+//---------------------------------------------------------------
+void BlurhashCache::insert(const BlurhashKey &key, const BlurhashValue &value)
+{
+  if(!isValid()) return;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  bindKey(m_statementInsert, key);
+  sqlite3_bind_int(m_statementInsert, 5, value.width);
+  sqlite3_bind_int(m_statementInsert, 6, value.height);
+  sqlite3_bind_text(m_statementInsert, 7, value.hash.c_str(), static_cast<int>(value.hash.size()), SQLITE_TRANSIENT);
+  sqlite3_step(m_statementInsert);
+  sqlite3_reset(m_statementInsert);
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+TEST_CASE("blurhash cache")
+{
+  BlurhashCache cache(":memory:");
+  REQUIRE(cache.isValid());
+
+  BlurhashKey key;
+  key.path = "C:\\Music\\Album\\Frontal.jpg";
+  key.size = 1234;
+  key.writeTime = 638000000000000000;
+  key.workSize = 128;
+
+  BlurhashValue value;
+  CHECK_FALSE(cache.find(key, value));
+
+  value.width = 600;
+  value.height = 500;
+  value.hash = "LEHV6nWB2yk8pyo0adR*.7kCMdnj";
+  cache.insert(key, value);
+
+  BlurhashValue cached;
+  CHECK(cache.find(key, cached));
+  CHECK(cached.width == 600);
+  CHECK(cached.height == 500);
+  CHECK(cached.hash == value.hash);
+
+  // Modified file or different working size is a miss.
+  key.writeTime += 1;
+  CHECK_FALSE(cache.find(key, cached));
+  key.writeTime -= 1;
+  key.workSize = 64;
+  CHECK_FALSE(cache.find(key, cached));
+
+  CHECK(cache.hits() == 1);
+  CHECK(cache.misses() == 3);
+}
+#endif
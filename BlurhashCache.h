@@ -0,0 +1,143 @@
+/*
+ File: BlurhashCache.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLURHASHCACHE_H_
+#define BLURHASHCACHE_H_
+
+// Qt
+#include <QString>
+
+// C++
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+/** \struct BlurhashKey
+ * \brief Identifies an image file and the parameters used to compute its blurhash.
+ *
+ */
+struct BlurhashKey
+{
+    std::string   path;      /** canonical path of the image file. */
+    unsigned long size;      /** size of the file in bytes. */
+    long long     writeTime; /** last write time of the file. */
+    int           workSize;  /** maximum size of the image used to compute the blurhash. */
+
+    BlurhashKey()
+    : size{0}
+    , writeTime{0}
+    , workSize{0}
+    {};
+};
+
+/** \struct BlurhashValue
+ * \brief Cached image information.
+ *
+ */
+struct BlurhashValue
+{
+    int         width;  /** image width. */
+    int         height; /** image height. */
+    std::string hash;   /** blurhash string. */
+
+    BlurhashValue()
+    : width{0}
+    , height{0}
+    {};
+};
+
+/** \class BlurhashCache
+ * \brief Persistent cache of computed blurhashes in a SQLite file. Can be used concurrently
+ * from several threads. Changes are written when the object is destroyed.
+ *
+ */
+class BlurhashCache
+{
+  public:
+    /** \brief BlurhashCache class constructor. Opens or creates the cache file.
+     * \param[in] file Cache file path.
+     *
+     */
+    explicit BlurhashCache(const std::filesystem::path &file);
+
+    /** \brief BlurhashCache class destructor. Commits the new entries and closes the file.
+     *
+     */
+    ~BlurhashCache();
+
+    /** \brief Returns true if the cache file could be opened and initialized.
+     *
+     */
+    bool isValid() const
+    { return m_statementFind && m_statementInsert; }
+
+    /** \brief Returns the error message or empty if none.
+     *
+     */
+    QString error() const
+    { return m_error; }
+
+    /** \brief Searches the given key in the cache. Returns true if found, false otherwise.
+     * \param[in] key Image key.
+     * \param[out] value Cached image information.
+     *
+     */
+    bool find(const BlurhashKey &key, BlurhashValue &value);
+
+    /** \brief Stores the image information in the cache, replacing any previous value.
+     * \param[in] key Image key.
+     * \param[in] value Image information.
+     *
+     */
+    void insert(const BlurhashKey &key, const BlurhashValue &value);
+
+    /** \brief Returns the number of successful searches.
+     *
+     */
+    unsigned long hits() const
+    { return m_hits; }
+
+    /** \brief Returns the number of failed searches.
+     *
+     */
+    unsigned long misses() const
+    { return m_misses; }
+
+  private:
+    /** \brief Binds the key values to the first parameters of the given statement.
+     * \param[in] statement SQLite statement.
+     * \param[in] key Image key.
+     *
+     */
+    void bindKey(sqlite3_stmt *statement, const BlurhashKey &key);
+
+    std::mutex                 m_mutex;           /** protects the database connection. */
+    sqlite3                   *m_db;              /** cache database. */
+    sqlite3_stmt              *m_statementFind;   /** search statement. */
+    sqlite3_stmt              *m_statementInsert; /** insert statement. */
+    QString                    m_error;           /** error message or empty if none. */
+    std::atomic<unsigned long> m_hits;            /** number of successful searches. */
+    std::atomic<unsigned long> m_misses;          /** number of failed searches. */
+};
+
+#endif // BLURHASHCACHE_H_
@@ -0,0 +1,183 @@
+/*
+ File: BoundedQueue.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOUNDEDQUEUE_H_
+#define BOUNDEDQUEUE_H_
+
+// C++
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/** \class BoundedQueue
+ * \brief Queue of a fixed maximum size between a producer and a consumer thread. The producer
+ * blocks while the queue is full and the consumer while it's empty, until the queue is closed.
+ *
+ */
+template<class T>
+class BoundedQueue
+{
+  public:
+    /** \brief BoundedQueue class constructor.
+     * \param[in] capacity Maximum number of elements in the queue, at least 1.
+     *
+     */
+    explicit BoundedQueue(size_t capacity)
+    : m_capacity{std::max<size_t>(1, capacity)}
+    , m_maximum{0}
+    , m_fullWaits{0}
+    , m_emptyWaits{0}
+    , m_closed{false}
+    {}
+
+    /** \brief Adds the value to the queue, waiting while it's full. Returns false if the queue
+     * has been closed and the value was not added.
+     * \param[in] value Value to add.
+     *
+     */
+    bool push(T &&value)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if(!m_closed && m_items.size() >= m_capacity) ++m_fullWaits;
+      m_notFull.wait(lock, [this](){ return m_closed || m_items.size() < m_capacity; });
+      if(m_closed) return false;
+
+      m_items.push_back(std::move(value));
+      m_maximum = std::max(m_maximum, m_items.size());
+      m_notEmpty.notify_one();
+
+      return true;
+    }
+
+    /** \brief Removes the first value of the queue, waiting while it's empty. Returns false if
+     * the queue has been closed and has no values left.
+     * \param[out] value Removed value.
+     *
+     */
+    bool pop(T &value)
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if(!m_closed && m_items.empty()) ++m_emptyWaits;
+      m_notEmpty.wait(lock, [this](){ return m_closed || !m_items.empty(); });
+      if(m_items.empty()) return false;
+
+      value = std::move(m_items.front());
+      m_items.pop_front();
+      m_notFull.notify_one();
+
+      return true;
+    }
+
+    /** \brief Closes the queue. Waiting and later pushes fail, the values already in the queue
+     * can still be removed.
+     *
+     */
+    void close()
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_closed = true;
+      m_notFull.notify_all();
+      m_notEmpty.notify_all();
+    }
+
+    /** \brief Returns the maximum number of elements of the queue.
+     *
+     */
+    size_t capacity() const
+    { return m_capacity; }
+
+    /** \brief Returns the greatest number of elements the queue has had.
+     *
+     */
+    size_t maximum() const
+    { std::lock_guard<std::mutex> lock(m_mutex); return m_maximum; }
+
+    /** \brief Returns the number of times the producer waited because the queue was full.
+     *
+     */
+    unsigned long fullWaits() const
+    { std::lock_guard<std::mutex> lock(m_mutex); return m_fullWaits; }
+
+    /** \brief Returns the number of times the consumer waited because the queue was empty.
+     *
+     */
+    unsigned long emptyWaits() const
+    { std::lock_guard<std::mutex> lock(m_mutex); return m_emptyWaits; }
+
+  private:
+    const size_t            m_capacity;   /** maximum number of elements. */
+    std::deque<T>           m_items;      /** queued elements. */
+    size_t                  m_maximum;    /** greatest number of queued elements. */
+    unsigned long           m_fullWaits;  /** number of waits of the producer. */
+    unsigned long           m_emptyWaits; /** number of waits of the consumer. */
+    bool                    m_closed;     /** true if the queue has been closed. */
+    mutable std::mutex      m_mutex;      /** protects the queue data. */
+    std::condition_variable m_notFull;    /** signals free space or the close of the queue. */
+    std::condition_variable m_notEmpty;   /** signals a new element or the close of the queue. */
+};
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+TEST_CASE("bounded queue")
+{
+  BoundedQueue<int> queue(2);
+  CHECK(queue.capacity() == 2);
+  CHECK(queue.push(1));
+  CHECK(queue.push(2));
+
+  // Full, the producer waits until a value is removed.
+  std::atomic<bool> pushed{false};
+  std::thread producer([&queue, &pushed](){ pushed = queue.push(3); });
+  while(queue.fullWaits() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  CHECK_FALSE(pushed);
+
+  int value = 0;
+  CHECK(queue.pop(value));
+  CHECK(value == 1);
+  producer.join();
+  CHECK(pushed);
+  CHECK(queue.maximum() == 2);
+
+  // Full again, closing wakes the waiting producer and its value is not added.
+  std::thread blocked([&queue, &pushed](){ pushed = queue.push(5); });
+  while(queue.fullWaits() < 2) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  queue.close();
+  blocked.join();
+  CHECK_FALSE(pushed);
+  CHECK_FALSE(queue.push(6));
+
+  // The values queued before closing can still be removed.
+  CHECK(queue.pop(value));
+  CHECK(value == 2);
+  CHECK(queue.pop(value));
+  CHECK(value == 3);
+  CHECK_FALSE(queue.pop(value));
+}
+#endif
+
+#endif // BOUNDEDQUEUE_H_
@@ -0,0 +1,323 @@
+/*
+ File: ChangeJournal.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <ChangeJournal.h>
+
+// SQLite
+#include <sqlite3/sqlite3.h>
+
+// C++
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#endif
+
+// Size in bytes of the header of each changeset in the journal.
+const size_t HEADER_SIZE = 4;
+
+//---------------------------------------------------------------
+static int changesetConflict(void *context, int, sqlite3_changeset_iter *)
+{
+  // The row has been modified after the journal was written, it's kept as it is.
+  auto conflicts = reinterpret_cast<unsigned long long *>(context);
+  ++(*conflicts);
+
+  return SQLITE_CHANGESET_OMIT;
+}
+
+//---------------------------------------------------------------
+ChangeJournal::ChangeJournal(sqlite3 *db, const std::string &table)
+: m_db{db}
+, m_table{table}
+, m_session{nullptr}
+, m_bytes{0}
+, m_created{false}
+{
+  assert(m_db);
+
+  // Sessions silently ignore the tables without a primary key.
+  sqlite3_stmt *statement = nullptr;
+  auto result = sqlite3_prepare_v2(m_db, "SELECT COUNT(*) FROM pragma_table_info(?) WHERE pk > 0", -1, &statement, nullptr);
+  if(result == SQLITE_OK)
+  {
+    sqlite3_bind_text(statement, 1, m_table.c_str(), m_table.length(), SQLITE_TRANSIENT);
+    result = sqlite3_step(statement);
+  }
+  const bool hasKey = (result == SQLITE_ROW) && sqlite3_column_int(statement, 0) > 0;
+  sqlite3_finalize(statement);
+
+  if(!hasKey)
+  {
+    m_error = QString("Unable to record the changes, table '%1' has no primary key.").arg(QString::fromStdString(m_table));
+    return;
+  }
+
+  start();
+}
+
+//---------------------------------------------------------------
+ChangeJournal::~ChangeJournal()
+{
+  if(m_session) sqlite3session_delete(m_session);
+}
+
+//---------------------------------------------------------------
+bool ChangeJournal::start()
+{
+  if(m_session) sqlite3session_delete(m_session);
+  m_session = nullptr;
+
+  auto result = sqlite3session_create(m_db, "main", &m_session);
+  if(result == SQLITE_OK) result = sqlite3session_attach(m_session, m_table.c_str());
+
+  if(result != SQLITE_OK)
+  {
+    m_error = QString("Unable to record the changes. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
+    if(m_session) sqlite3session_delete(m_session);
+    m_session = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------
+bool ChangeJournal::append(const std::filesystem::path &file)
+{
+  if(!m_session) return false;
+
+  const auto qFile = QString::fromStdWString(file.wstring());
+
+  int size = 0;
+  void *changeset = nullptr;
+  const auto result = sqlite3session_changeset(m_session, &size, &changeset);
+  if(result != SQLITE_OK)
+  {
+    m_error = QString("Unable to get the changes for journal file '%1'. SQLite3 error: %2").arg(qFile).arg(QString::fromLatin1(sqlite3_errstr(result)));
+    return false;
+  }
+
+  // Nothing to append, the file is still created on the first call.
+  if(size == 0 && m_created)
+  {
+    sqlite3_free(changeset);
+    return true;
+  }
+
+#ifdef _WIN32
+  auto stream = _wfopen(file.c_str(), m_created ? L"ab" : L"wb");
+#else
+  auto stream = std::fopen(file.c_str(), m_created ? "ab" : "wb");
+#endif
+  if(!stream)
+  {
+    sqlite3_free(changeset);
+    m_error = QString("Unable to open journal file '%1'.").arg(qFile);
+    return false;
+  }
+
+  bool written = true;
+  if(size > 0)
+  {
+    unsigned char header[HEADER_SIZE];
+    for(size_t i = 0; i < HEADER_SIZE; ++i)
+      header[i] = static_cast<unsigned char>((static_cast<unsigned long>(size) >> (8 * i)) & 0xFF);
+
+    written = std::fwrite(header, 1, HEADER_SIZE, stream) == HEADER_SIZE &&
+              std::fwrite(changeset, 1, size, stream) == static_cast<size_t>(size);
+  }
+  sqlite3_free(changeset);
+
+  // The changes can only be committed once they are on disk.
+  written = written && std::fflush(stream) == 0;
+#ifdef _WIN32
+  written = written && _commit(_fileno(stream)) == 0;
+#else
+  written = written && fsync(fileno(stream)) == 0;
+#endif
+  written = (std::fclose(stream) == 0) && written;
+
+  if(!written)
+  {
+    m_error = QString("Unable to write journal file '%1'.").arg(qFile);
+    return false;
+  }
+
+  m_created = true;
+  if(size > 0) m_bytes += HEADER_SIZE + size;
+
+  // The next changes are recorded in a new session.
+  return size == 0 || start();
+}
+
+//---------------------------------------------------------------
+bool ChangeJournal::rollback(sqlite3 *db, const std::filesystem::path &file, unsigned long long &changes,
+                             unsigned long long &conflicts, QString &error)
+{
+  assert(db);
+
+  changes = conflicts = 0;
+  const auto qFile = QString::fromStdWString(file.wstring());
+
+  std::ifstream stream(file, std::ios::binary);
+  if(!stream)
+  {
+    error = QString("Unable to open journal file '%1'.").arg(qFile);
+    return false;
+  }
+
+  // The journal is proportional to the size of the changes, it's read in memory.
+  const std::string journal{std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+  if(journal.empty()) return true;
+
+  // The changesets are combined so a row changed in several of them is restored to its first value.
+  sqlite3_changegroup *group = nullptr;
+  auto result = sqlite3changegroup_new(&group);
+  size_t position = 0;
+  while(result == SQLITE_OK && position + HEADER_SIZE <= journal.size())
+  {
+    unsigned long size = 0;
+    for(size_t i = 0; i < HEADER_SIZE; ++i)
+      size |= static_cast<unsigned long>(static_cast<unsigned char>(journal[position + i])) << (8 * i);
+    position += HEADER_SIZE;
+
+    // A changeset not completely written was never committed.
+    if(position + size > journal.size()) break;
+
+    result = sqlite3changegroup_add(group, static_cast<int>(size), const_cast<char *>(journal.data() + position));
+    position += size;
+  }
+
+  int combinedSize = 0;
+  void *combined = nullptr;
+  if(result == SQLITE_OK) result = sqlite3changegroup_output(group, &combinedSize, &combined);
+  sqlite3changegroup_delete(group);
+
+  int size = 0;
+  void *inverse = nullptr;
+  if(result == SQLITE_OK) result = sqlite3changeset_invert(combinedSize, combined, &size, &inverse);
+  sqlite3_free(combined);
+
+  if(result != SQLITE_OK)
+  {
+    error = QString("Invalid journal file '%1'. SQLite3 error: %2").arg(qFile).arg(QString::fromLatin1(sqlite3_errstr(result)));
+    return false;
+  }
+
+  const auto previous = sqlite3_total_changes64(db);
+  result = sqlite3changeset_apply(db, size, inverse, nullptr, changesetConflict, &conflicts);
+  sqlite3_free(inverse);
+
+  if(result != SQLITE_OK)
+  {
+    error = QString("Unable to apply journal file '%1'. SQLite3 error: %2").arg(qFile).arg(QString::fromLatin1(sqlite3_errmsg(db)));
+    return false;
+  }
+
+  changes = sqlite3_total_changes64(db) - previous;
+
+  return true;
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+TEST_CASE("change journal")
+{
+  sqlite3 *db = nullptr;
+  REQUIRE(sqlite3_open(":memory:", &db) == SQLITE_OK);
+  REQUIRE(sqlite3_exec(db, "CREATE TABLE t(id TEXT PRIMARY KEY, a, b); CREATE TABLE n(a);"
+                           "INSERT INTO t VALUES('1', 'x', NULL), ('2', 'y', 2), ('3', 'z', 3)", nullptr, nullptr, nullptr) == SQLITE_OK);
+
+  auto value = [db](const std::string &sql)
+  {
+    sqlite3_stmt *statement = nullptr;
+    sqlite3_prepare_v2(db, sql.c_str(), -1, &statement, nullptr);
+    sqlite3_step(statement);
+    const auto text = reinterpret_cast<const char *>(sqlite3_column_text(statement, 0));
+    const std::string result = text ? text : "NULL";
+    sqlite3_finalize(statement);
+    return result;
+  };
+
+  CHECK_FALSE(ChangeJournal(db, "n").isValid());
+
+  const auto file = std::filesystem::temp_directory_path() / "ChangeJournalTest.changeset";
+
+  {
+    ChangeJournal journal(db, "t");
+    REQUIRE(journal.isValid());
+
+    REQUIRE(sqlite3_exec(db, "UPDATE t SET a='changed', b=10 WHERE id IN ('1', '2'); UPDATE t SET b=30 WHERE id='3'",
+                         nullptr, nullptr, nullptr) == SQLITE_OK);
+    REQUIRE(journal.append(file));
+    const auto first = journal.bytes();
+    CHECK(first > 0);
+    CHECK(std::filesystem::file_size(file) == first);
+
+    // Only the changes of the next batch are appended, rows can change in several batches.
+    REQUIRE(sqlite3_exec(db, "UPDATE t SET a='other' WHERE id='3'; UPDATE t SET a='again' WHERE id='1'", nullptr, nullptr, nullptr) == SQLITE_OK);
+    REQUIRE(journal.append(file));
+    CHECK(journal.bytes() > first);
+    CHECK(std::filesystem::file_size(file) == journal.bytes());
+
+    // Without changes nothing is appended.
+    const auto bytes = journal.bytes();
+    REQUIRE(journal.append(file));
+    CHECK(journal.bytes() == bytes);
+  }
+
+  // A changeset interrupted while being written is ignored.
+  {
+    std::ofstream stream(file, std::ios::binary|std::ios::app);
+    stream.write("\xFF\x00\x00\x00T", 5);
+  }
+
+  // Changed again after the journal, not restored.
+  REQUIRE(sqlite3_exec(db, "UPDATE t SET b=300 WHERE id='3'", nullptr, nullptr, nullptr) == SQLITE_OK);
+
+  unsigned long long changes = 0, conflicts = 0;
+  QString error;
+  CHECK(ChangeJournal::rollback(db, file, changes, conflicts, error));
+  CHECK(changes == 2);
+  CHECK(conflicts == 1);
+  CHECK(value("SELECT a FROM t WHERE id='1'") == "x");
+  CHECK(value("SELECT b FROM t WHERE id='1'") == "NULL");
+  CHECK(value("SELECT a FROM t WHERE id='2'") == "y");
+  CHECK(value("SELECT b FROM t WHERE id='2'") == "2");
+  CHECK(value("SELECT a FROM t WHERE id='3'") == "other");
+  CHECK(value("SELECT b FROM t WHERE id='3'") == "300");
+
+  std::filesystem::remove(file);
+  sqlite3_close(db);
+}
+#endif
@@ -0,0 +1,108 @@
+/*
+ File: ChangeJournal.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CHANGEJOURNAL_H_
+#define CHANGEJOURNAL_H_
+
+// Qt
+#include <QString>
+
+// C++
+#include <filesystem>
+#include <string>
+
+struct sqlite3;
+struct sqlite3_session;
+
+/** \class ChangeJournal
+ * \brief Records the changes made to a table with the SQLite session extension and appends them
+ * to a journal as changesets, that contain the primary key and the previous value of the modified
+ * columns of each changed row. Each changeset is stored after its size so a changeset that was not
+ * completely written can be detected. Applying the inverse of the changesets undoes the changes.
+ *
+ */
+class ChangeJournal
+{
+  public:
+    /** \brief ChangeJournal class constructor. Starts recording the changes of the table.
+     * \param[in] db SQLite db handle.
+     * \param[in] table Name of the recorded table, must have a primary key.
+     *
+     */
+    explicit ChangeJournal(sqlite3 *db, const std::string &table);
+
+    /** \brief ChangeJournal class destructor.
+     *
+     */
+    ~ChangeJournal();
+
+    /** \brief Returns true if the changes are being recorded.
+     *
+     */
+    bool isValid() const
+    { return m_session != nullptr; }
+
+    /** \brief Returns the error message or empty if none.
+     *
+     */
+    QString error() const
+    { return m_error; }
+
+    /** \brief Appends the changes recorded since the previous call to the file and waits until they
+     * are on disk, the first call truncates the file. Must be called before committing the changes.
+     * Returns true on success and false otherwise.
+     * \param[in] file Journal file path.
+     *
+     */
+    bool append(const std::filesystem::path &file);
+
+    /** \brief Returns the size in bytes of the journal.
+     *
+     */
+    unsigned long long bytes() const
+    { return m_bytes; }
+
+    /** \brief Undoes the changes of the journal in a single transaction. Rows changed again after the
+     * journal was written are not modified and are counted as conflicts. Returns true on success and
+     * false otherwise.
+     * \param[in] db SQLite db handle.
+     * \param[in] file Journal file path.
+     * \param[out] changes Number of restored rows.
+     * \param[out] conflicts Number of rows not restored.
+     * \param[out] error Error message or empty if none.
+     *
+     */
+    static bool rollback(sqlite3 *db, const std::filesystem::path &file, unsigned long long &changes,
+                         unsigned long long &conflicts, QString &error);
+
+  private:
+    /** \brief Starts a new session on the table. Returns true on success and false otherwise.
+     *
+     */
+    bool start();
+
+    sqlite3           *m_db;      /** SQLite db handle. */
+    const std::string  m_table;   /** name of the recorded table. */
+    sqlite3_session   *m_session; /** SQLite session or nullptr on error. */
+    QString            m_error;   /** error message or empty if none. */
+    unsigned long long m_bytes;   /** size of the journal. */
+    bool               m_created; /** true if the journal file has been created. */
+};
+
+#endif // CHANGEJOURNAL_H_
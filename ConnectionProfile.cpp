@@ -0,0 +1,220 @@
+/*
+ File: ConnectionProfile.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <ConnectionProfile.h>
+
+// SQLite
+#include <sqlite3/sqlite3.h>
+
+// C++
+#include <cassert>
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#include <filesystem>
+#endif
+
+//---------------------------------------------------------------
+ConnectionProfile::ConnectionProfile(sqlite3 *db)
+: m_db{db}
+{
+  assert(m_db);
+}
+
+//---------------------------------------------------------------
+ConnectionProfile::~ConnectionProfile()
+{
+  restore();
+}
+
+//---------------------------------------------------------------
+std::vector<PragmaValue> ConnectionProfile::bulkMaintenance()
+{
+  // The locking mode goes first, the journal mode can't leave WAL without exclusive access.
+  // The cache is 256 MB, the memory map is limited by the SQLITE_MAX_MMAP_SIZE of the build.
+  return { {"locking_mode", "EXCLUSIVE"}, {"journal_mode", "MEMORY"}, {"synchronous", "OFF"},
+           {"cache_size", "-262144"}, {"mmap_size", "2147418112"}, {"temp_store", "MEMORY"} };
+}
+
+//---------------------------------------------------------------
+bool ConnectionProfile::apply(const std::vector<PragmaValue> &pragmas)
+{
+  if(!restore()) return false;
+
+  for(const auto &pragma: pragmas)
+  {
+    // Pragmas not supported by the build return no value and are ignored.
+    const auto previous = value(pragma.name);
+    if(previous.empty()) continue;
+
+    if(!set(pragma))
+    {
+      const auto error = m_error;
+      restore();
+      m_error = error;
+      return false;
+    }
+
+    m_previous.push_back(PragmaValue{pragma.name, previous});
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------
+bool ConnectionProfile::restore()
+{
+  bool result = true;
+
+  m_error.clear();
+  if(m_previous.empty()) return result;
+
+  // The journal mode is restored last. Entering WAL with exclusive locking keeps the lock until
+  // the connection is closed, even if the normal locking mode is set afterwards.
+  std::vector<PragmaValue> journal;
+  while(!m_previous.empty())
+  {
+    if(m_previous.back().name == "journal_mode") journal.push_back(m_previous.back());
+    else if(!set(m_previous.back())) result = false;
+    m_previous.pop_back();
+  }
+
+  // The exclusive lock is released on the next access after setting the normal locking mode.
+  if(sqlite3_exec(m_db, "SELECT 1 FROM sqlite_master LIMIT 1", nullptr, nullptr, nullptr) != SQLITE_OK)
+  {
+    m_error = QString("Unable to release the database lock. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errmsg(m_db)));
+    result = false;
+  }
+
+  for(const auto &pragma: journal)
+    if(!set(pragma)) result = false;
+
+  return result;
+}
+
+//---------------------------------------------------------------
+std::vector<PragmaValue> ConnectionProfile::active() const
+{
+  std::vector<PragmaValue> values;
+  for(const auto &pragma: m_previous)
+    values.push_back(PragmaValue{pragma.name, value(pragma.name)});
+
+  return values;
+}
+
+//---------------------------------------------------------------
+std::string ConnectionProfile::value(const std::string &name) const
+{
+  std::string result;
+
+  const auto sql = std::string("PRAGMA ") + name;
+  sqlite3_stmt *statement = nullptr;
+  if(sqlite3_prepare_v2(m_db, sql.c_str(), -1, &statement, nullptr) == SQLITE_OK && sqlite3_step(statement) == SQLITE_ROW)
+  {
+    const auto text = reinterpret_cast<const char *>(sqlite3_column_text(statement, 0));
+    if(text) result = text;
+  }
+  sqlite3_finalize(statement);
+
+  return result;
+}
+
+//---------------------------------------------------------------
+bool ConnectionProfile::set(const PragmaValue &pragma)
+{
+  const auto sql = std::string("PRAGMA ") + pragma.name + "=" + pragma.value;
+  sqlite3_stmt *statement = nullptr;
+  auto result = sqlite3_prepare_v2(m_db, sql.c_str(), -1, &statement, nullptr);
+  if(result == SQLITE_OK) result = sqlite3_step(statement);
+
+  // The journal mode pragma returns the resulting mode, that is the previous one if it can't be changed.
+  std::string mode;
+  if(result == SQLITE_ROW && pragma.name == "journal_mode" && sqlite3_column_text(statement, 0))
+    mode = reinterpret_cast<const char *>(sqlite3_column_text(statement, 0));
+  sqlite3_finalize(statement);
+
+  if(result != SQLITE_ROW && result != SQLITE_DONE)
+  {
+    m_error = QString("Unable to set '%1'. SQLite3 error: %2").arg(QString::fromStdString(sql)).arg(QString::fromLatin1(sqlite3_errmsg(m_db)));
+    return false;
+  }
+
+  if(pragma.name == "journal_mode" && sqlite3_stricmp(mode.c_str(), pragma.value.c_str()) != 0)
+  {
+    m_error = QString("Unable to set '%1', journal mode is '%2'.").arg(QString::fromStdString(sql)).arg(QString::fromStdString(mode));
+    return false;
+  }
+
+  return true;
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+TEST_CASE("connection profile")
+{
+  const auto file = std::filesystem::temp_directory_path() / "ConnectionProfileTest.db";
+  std::filesystem::remove(file);
+
+  sqlite3 *db = nullptr;
+  REQUIRE(sqlite3_open(file.string().c_str(), &db) == SQLITE_OK);
+  REQUIRE(sqlite3_exec(db, "PRAGMA journal_mode=WAL; CREATE TABLE t(x)", nullptr, nullptr, nullptr) == SQLITE_OK);
+
+  auto pragma = [db](const std::string &name)
+  {
+    sqlite3_stmt *statement = nullptr;
+    sqlite3_prepare_v2(db, ("PRAGMA " + name).c_str(), -1, &statement, nullptr);
+    sqlite3_step(statement);
+    const std::string value = reinterpret_cast<const char *>(sqlite3_column_text(statement, 0));
+    sqlite3_finalize(statement);
+    return value;
+  };
+
+  {
+    ConnectionProfile profile(db);
+    CHECK(profile.apply(ConnectionProfile::bulkMaintenance()));
+    CHECK(pragma("journal_mode") == "memory");
+    CHECK(pragma("locking_mode") == "exclusive");
+    CHECK(pragma("synchronous") == "0");
+    CHECK(pragma("cache_size") == "-262144");
+    CHECK(pragma("temp_store") == "2");
+    CHECK(profile.active().size() >= 5);
+
+    CHECK(sqlite3_exec(db, "INSERT INTO t VALUES(1)", nullptr, nullptr, nullptr) == SQLITE_OK);
+  }
+
+  CHECK(pragma("journal_mode") == "wal");
+  CHECK(pragma("synchronous") == "2");
+  CHECK(pragma("temp_store") == "0");
+
+  // The lock is released, other connections can write while this one is still open.
+  sqlite3 *other = nullptr;
+  REQUIRE(sqlite3_open(file.string().c_str(), &other) == SQLITE_OK);
+  CHECK(sqlite3_exec(other, "INSERT INTO t VALUES(2)", nullptr, nullptr, nullptr) == SQLITE_OK);
+  sqlite3_close(other);
+
+  CHECK(sqlite3_exec(db, "SELECT COUNT(*) FROM t", nullptr, nullptr, nullptr) == SQLITE_OK);
+
+  sqlite3_close(db);
+  std::filesystem::remove(file);
+}
+#endif
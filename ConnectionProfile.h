@@ -0,0 +1,117 @@
+/*
+ File: ConnectionProfile.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONNECTIONPROFILE_H_
+#define CONNECTIONPROFILE_H_
+
+// Qt
+#include <QString>
+
+// C++
+#include <string>
+#include <vector>
+
+struct sqlite3;
+
+/** \struct PragmaValue
+ * \brief Name and value of an SQLite pragma.
+ *
+ */
+struct PragmaValue
+{
+    std::string name;  /** pragma name. */
+    std::string value; /** pragma value. */
+};
+
+/** \class ConnectionProfile
+ * \brief Sets a group of pragmas on a connection and restores their previous values
+ * afterwards, or on destruction if not done explicitly.
+ *
+ */
+class ConnectionProfile
+{
+  public:
+    /** \brief ConnectionProfile class constructor.
+     * \param[in] db SQLite db handle.
+     *
+     */
+    explicit ConnectionProfile(sqlite3 *db);
+
+    /** \brief ConnectionProfile class destructor. Restores the previous values if applied.
+     *
+     */
+    ~ConnectionProfile();
+
+    /** \brief Stores the current values of the pragmas and sets the given ones, in order.
+     * Returns true on success and false otherwise, on error the values already set are restored.
+     * \param[in] pragmas Pragmas to set.
+     *
+     */
+    bool apply(const std::vector<PragmaValue> &pragmas);
+
+    /** \brief Sets the values the pragmas had before apply(), in reverse order except the journal
+     * mode that is restored last, once the exclusive lock is released. Returns true on success and
+     * false otherwise.
+     *
+     */
+    bool restore();
+
+    /** \brief Returns the values of the applied pragmas as reported by the database.
+     *
+     */
+    std::vector<PragmaValue> active() const;
+
+    /** \brief Returns the values the pragmas had before apply(), empty if not applied.
+     *
+     */
+    const std::vector<PragmaValue> &previous() const
+    { return m_previous; }
+
+    /** \brief Returns the error message of the last operation or empty if none.
+     *
+     */
+    QString error() const
+    { return m_error; }
+
+    /** \brief Returns the pragmas for bulk maintenance runs on a database that has been copied
+     * before the run: exclusive access, journal in memory, no syncs, big page cache, memory
+     * mapped I/O and temporary tables in memory.
+     *
+     */
+    static std::vector<PragmaValue> bulkMaintenance();
+
+  private:
+    /** \brief Returns the value of the pragma or empty on error.
+     * \param[in] name Pragma name.
+     *
+     */
+    std::string value(const std::string &name) const;
+
+    /** \brief Sets the value of the pragma. Returns true on success and false otherwise.
+     * \param[in] pragma Pragma name and value.
+     *
+     */
+    bool set(const PragmaValue &pragma);
+
+    sqlite3                 *m_db;       /** SQLite db handle. */
+    std::vector<PragmaValue> m_previous; /** values before applying, in application order. */
+    QString                  m_error;    /** error message or empty if none. */
+};
+
+#endif // CONNECTIONPROFILE_H_
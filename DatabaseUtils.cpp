@@ -0,0 +1,375 @@
+/*
+ File: DatabaseUtils.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <DatabaseUtils.h>
+#include <JellyfinDefinitions.h>
+
+// SQLite
+#include <sqlite3/sqlite3.h>
+
+// Qt
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QSettings>
+
+// C++
+#include <cstring>
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#endif
+
+// Blurhash cache file name, stored in the same folder as the user settings.
+const QString BLURHASH_CACHE = "JellyfinDatabaseTweaker_blurhash.db";
+
+const int PAGES_PER_STEP = 1024; // Pages copied in each step of the backup.
+const int BUSY_WAIT = 50;        // Time in ms to wait if the database is locked during the backup.
+
+//---------------------------------------------------------------
+std::filesystem::path backupFileName(const std::filesystem::path &database)
+{
+  const auto currentTime = QDateTime::currentDateTime().toString("dd_MM_yyyy-hh_mm_ss");
+
+  auto backup = database.parent_path();
+  backup /= database.stem();
+  backup += std::string("_backup-") + currentTime.toStdString() + database.extension().string();
+
+  return backup;
+}
+
+//---------------------------------------------------------------
+std::filesystem::path planFileName(const std::filesystem::path &database)
+{
+  const auto currentTime = QDateTime::currentDateTime().toString("dd_MM_yyyy-hh_mm_ss");
+
+  auto plan = database.parent_path();
+  plan /= database.stem();
+  plan += std::string("_plan-") + currentTime.toStdString() + ".tsv";
+
+  return plan;
+}
+
+//---------------------------------------------------------------
+std::filesystem::path journalFileName(const std::filesystem::path &database)
+{
+  const auto currentTime = QDateTime::currentDateTime().toString("dd_MM_yyyy-hh_mm_ss");
+
+  auto journal = database.parent_path();
+  journal /= database.stem();
+  journal += std::string("_journal-") + currentTime.toStdString() + ".changeset";
+
+  return journal;
+}
+
+//---------------------------------------------------------------
+std::filesystem::path stateFileName(const std::filesystem::path &database)
+{
+  auto state = database.parent_path();
+  state /= database.stem();
+  state += "_state.db";
+
+  return state;
+}
+
+//---------------------------------------------------------------
+static bool hashPage(sqlite3_stmt *statement, int page, QCryptographicHash &hash)
+{
+  sqlite3_reset(statement);
+  sqlite3_bind_int(statement, 1, page);
+  if(sqlite3_step(statement) != SQLITE_ROW) return false;
+
+  const auto data = reinterpret_cast<const char *>(sqlite3_column_blob(statement, 0));
+  const auto size = sqlite3_column_bytes(statement, 0);
+  if(!data || size < 100) return false;
+
+  if(page == 1)
+  {
+    // The copy updates the file change counter (bytes 24-27) and the version-valid-for
+    // number (bytes 92-95) of the database header, the rest of the pages are identical.
+    char header[100];
+    std::memcpy(header, data, 100);
+    std::memset(header + 24, 0, 4);
+    std::memset(header + 92, 0, 4);
+    hash.addData(header, 100);
+    hash.addData(data + 100, size - 100);
+  }
+  else
+  {
+    hash.addData(data, size);
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------
+bool copyDatabase(const std::filesystem::path &database, const std::filesystem::path &copy, bool verify,
+                  const CopyProgress &progress, QString &error)
+{
+  const auto qDatabase = QString::fromStdWString(database.wstring());
+  const auto qCopy = QString::fromStdWString(copy.wstring());
+
+  if(std::filesystem::exists(copy))
+  {
+    error = QString("Unable to backup file: '%1' to '%2'. Destination file exists!").arg(qDatabase).arg(qCopy);
+    return false;
+  }
+
+  sqlite3 *source = nullptr;
+  sqlite3 *destination = nullptr;
+  sqlite3_stmt *sourcePage = nullptr;
+  sqlite3_backup *backup = nullptr;
+
+  auto finish = [&](bool success)
+  {
+    if(backup) sqlite3_backup_finish(backup);
+    sqlite3_finalize(sourcePage);
+    sqlite3_close(source);
+    sqlite3_close(destination);
+
+    std::error_code errorCode;
+    if(!success) std::filesystem::remove(copy, errorCode);
+
+    return success;
+  };
+
+  auto result = sqlite3_open_v2(qDatabase.toUtf8().constData(), &source, SQLITE_OPEN_READONLY, nullptr);
+  if(result == SQLITE_OK) result = sqlite3_open_v2(qCopy.toUtf8().constData(), &destination, SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE, nullptr);
+  if(result != SQLITE_OK)
+  {
+    error = QString("Unable to backup file: '%1' to '%2'. SQLite3 error: %3").arg(qDatabase).arg(qCopy).arg(QString::fromLatin1(sqlite3_errstr(result)));
+    return finish(false);
+  }
+
+  const char *PAGE_SQL = "SELECT data FROM sqlite_dbpage WHERE pgno=?";
+  if(verify && sqlite3_prepare_v2(source, PAGE_SQL, -1, &sourcePage, nullptr) != SQLITE_OK)
+  {
+    error = QString("Unable to verify backup of '%1', SQLite3 error: %2").arg(qDatabase).arg(QString::fromLatin1(sqlite3_errmsg(source)));
+    return finish(false);
+  }
+
+  backup = sqlite3_backup_init(destination, "main", source, "main");
+  if(!backup)
+  {
+    error = QString("Unable to backup file: '%1' to '%2'. SQLite3 error: %3").arg(qDatabase).arg(qCopy).arg(QString::fromLatin1(sqlite3_errmsg(destination)));
+    return finish(false);
+  }
+
+  // Pages are copied in order, the pages copied in each step are hashed from the source before the next one.
+  QCryptographicHash sourceHash(QCryptographicHash::Sha1);
+  int hashed = 0;
+
+  do
+  {
+    result = sqlite3_backup_step(backup, PAGES_PER_STEP);
+
+    const int total = sqlite3_backup_pagecount(backup);
+    const int copied = total - sqlite3_backup_remaining(backup);
+
+    if(verify && (result == SQLITE_OK || result == SQLITE_DONE))
+    {
+      // The copy restarts if the database is modified by other connection.
+      if(copied < hashed)
+      {
+        sourceHash.reset();
+        hashed = 0;
+      }
+
+      for(; hashed < copied; ++hashed)
+      {
+        if(!hashPage(sourcePage, hashed + 1, sourceHash))
+        {
+          error = QString("Unable to verify backup of '%1', can't read page %2.").arg(qDatabase).arg(hashed + 1);
+          return finish(false);
+        }
+      }
+    }
+
+    if(progress && !progress(copied, total))
+    {
+      error = QString("Backup of '%1' aborted.").arg(qDatabase);
+      return finish(false);
+    }
+
+    if(result == SQLITE_BUSY || result == SQLITE_LOCKED) sqlite3_sleep(BUSY_WAIT);
+  }
+  while(result == SQLITE_OK || result == SQLITE_BUSY || result == SQLITE_LOCKED);
+
+  result = sqlite3_backup_finish(backup);
+  backup = nullptr;
+  if(result != SQLITE_OK)
+  {
+    error = QString("Unable to backup file: '%1' to '%2'. SQLite3 error: %3").arg(qDatabase).arg(qCopy).arg(QString::fromLatin1(sqlite3_errstr(result)));
+    return finish(false);
+  }
+
+  if(verify)
+  {
+    QCryptographicHash copyHash(QCryptographicHash::Sha1);
+    sqlite3_stmt *copyPage = nullptr;
+    bool valid = sqlite3_prepare_v2(destination, PAGE_SQL, -1, &copyPage, nullptr) == SQLITE_OK;
+
+    int pages = 0;
+    while(valid && hashPage(copyPage, pages + 1, copyHash)) ++pages;
+    sqlite3_finalize(copyPage);
+
+    if(!valid || pages != hashed || copyHash.result() != sourceHash.result())
+    {
+      error = QString("Backup verification failed: '%1' is not equal to '%2'.").arg(qCopy).arg(qDatabase);
+      return finish(false);
+    }
+  }
+
+  return finish(true);
+}
+
+//---------------------------------------------------------------
+bool backupDatabase(const std::filesystem::path &database, std::filesystem::path &backup, QString &error, bool verify)
+{
+  backup = backupFileName(database);
+
+  return copyDatabase(database, backup, verify, CopyProgress(), error);
+}
+
+//---------------------------------------------------------------
+bool initializeSQLite(SQLiteLog log, void *data, QString &error)
+{
+  // The configuration fails with SQLITE_MISUSE once the library has been initialized.
+  auto result = sqlite3_config(SQLITE_CONFIG_MULTITHREAD);
+  if(result == SQLITE_OK && log) result = sqlite3_config(SQLITE_CONFIG_LOG, log, data);
+  if(result == SQLITE_OK) result = sqlite3_initialize();
+
+  if(result != SQLITE_OK)
+  {
+    error = QString("Unable to initialize SQLite. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
+    return false;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------
+sqlite3 *openDatabase(const std::filesystem::path &database, QString &error)
+{
+  const auto qDatabase = QString::fromStdWString(database.wstring());
+
+  if(!std::filesystem::exists(database))
+  {
+    error = QString("Unable to open file: '%1'").arg(qDatabase);
+    return nullptr;
+  }
+
+  sqlite3 *db = nullptr;
+  auto result = sqlite3_open(qDatabase.toUtf8().constData(), &db);
+  if(result != SQLITE_OK)
+  {
+    error = QString("Unable to open database: '%1'. SQLite3 error: %2").arg(qDatabase).arg(QString::fromLatin1(sqlite3_errstr(result)));
+    sqlite3_close(db);
+    return nullptr;
+  }
+
+  sqlite3_stmt *stmt;
+  result = sqlite3_prepare_v2(db, "SELECT * FROM sqlite_master where type='table'", -1, &stmt, nullptr);
+  if (result != SQLITE_OK)
+  {
+    error = QString("Unable to make SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
+    sqlite3_close(db);
+    return nullptr;
+  }
+
+  bool hasTable = false;
+  while ((result = sqlite3_step(stmt)) == SQLITE_ROW)
+  {
+    auto name = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
+    if(TABLE_NAME.compare(name) == 0)
+    {
+      hasTable = true;
+      result = SQLITE_DONE;
+      break;
+    }
+  }
+
+  sqlite3_finalize(stmt);
+
+  if (result != SQLITE_DONE)
+  {
+    error = QString("Unable to finish SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
+    sqlite3_close(db);
+    return nullptr;
+  }
+
+  if(!hasTable)
+  {
+    error = QString("Database: '%1' doesn't contain the correct tables.").arg(qDatabase);
+    sqlite3_close(db);
+    return nullptr;
+  }
+
+  return db;
+}
+
+//---------------------------------------------------------------
+QString defaultBlurhashCacheFile()
+{
+  const QSettings settings(QSettings::IniFormat, QSettings::UserScope, "Felix de las Pozas Alvarez", "JellyfinDatabaseTweaker");
+  const QDir settingsDir(QFileInfo(settings.fileName()).absolutePath());
+
+  return settingsDir.mkpath(".") ? settingsDir.filePath(BLURHASH_CACHE) : QString();
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+TEST_CASE("database copy")
+{
+  const auto folder = std::filesystem::temp_directory_path();
+  const auto file = folder / "DatabaseCopyTest.db";
+  const auto copy = folder / "DatabaseCopyTest_copy.db";
+  std::filesystem::remove(file);
+  std::filesystem::remove(copy);
+
+  sqlite3 *db = nullptr;
+  REQUIRE(sqlite3_open(file.string().c_str(), &db) == SQLITE_OK);
+  REQUIRE(sqlite3_exec(db, "CREATE TABLE t(x); WITH RECURSIVE c(i) AS (SELECT 1 UNION ALL SELECT i+1 FROM c WHERE i<5000) "
+                           "INSERT INTO t SELECT randomblob(1000) FROM c", nullptr, nullptr, nullptr) == SQLITE_OK);
+  sqlite3_close(db);
+
+  QString error;
+  int steps = 0, lastCopied = 0, lastTotal = 0;
+  auto progress = [&](int copied, int total) { ++steps; lastCopied = copied; lastTotal = total; return true; };
+  CHECK(copyDatabase(file, copy, true, progress, error));
+  CHECK(std::filesystem::exists(copy));
+  CHECK(steps > 1);
+  CHECK(lastCopied == lastTotal);
+
+  // Destination exists.
+  CHECK_FALSE(copyDatabase(file, copy, false, CopyProgress(), error));
+  std::filesystem::remove(copy);
+
+  // Aborted copies are removed.
+  CHECK_FALSE(copyDatabase(file, copy, true, [](int, int) { return false; }, error));
+  CHECK_FALSE(std::filesystem::exists(copy));
+
+  std::filesystem::remove(file);
+}
+#endif
@@ -0,0 +1,116 @@
+/*
+ File: DatabaseUtils.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATABASEUTILS_H_
+#define DATABASEUTILS_H_
+
+// Qt
+#include <QString>
+
+// C++
+#include <filesystem>
+#include <functional>
+
+struct sqlite3;
+
+/** \brief Callback of the copy progress, receives the copied and total pages and returns false to
+ * abort the copy.
+ *
+ */
+using CopyProgress = std::function<bool(int copied, int total)>;
+
+/** \brief Returns the path of a backup of the database, in the same folder with the current date
+ * and time in the name.
+ * \param[in] database Database file path.
+ *
+ */
+std::filesystem::path backupFileName(const std::filesystem::path &database);
+
+/** \brief Returns the path of the plan file of a dry run of the database, in the same folder with
+ * the current date and time in the name.
+ * \param[in] database Database file path.
+ *
+ */
+std::filesystem::path planFileName(const std::filesystem::path &database);
+
+/** \brief Returns the path of the changes journal of an update of the database, in the same folder
+ * with the current date and time in the name.
+ * \param[in] database Database file path.
+ *
+ */
+std::filesystem::path journalFileName(const std::filesystem::path &database);
+
+/** \brief Returns the path of the run state of the database, in the same folder.
+ * \param[in] database Database file path.
+ *
+ */
+std::filesystem::path stateFileName(const std::filesystem::path &database);
+
+/** \brief Copies the database page by page with the SQLite online backup API, in steps so the copy
+ * can report progress and be aborted. If verify is true the pages of the database are hashed while
+ * they are copied and compared with the hash of the copy at the end. The copy is removed on failure.
+ * Returns true on success and false otherwise.
+ * \param[in] database Database file path.
+ * \param[in] copy Destination file path, must not exist.
+ * \param[in] verify True to verify the copy.
+ * \param[in] progress Progress callback or empty.
+ * \param[out] error Error message if the copy failed.
+ *
+ */
+bool copyDatabase(const std::filesystem::path &database, const std::filesystem::path &copy, bool verify,
+                  const CopyProgress &progress, QString &error);
+
+/** \brief Copies the database to the backup file name. Returns true on success and false otherwise.
+ * \param[in] database Database file path.
+ * \param[out] backup Backup file path.
+ * \param[out] error Error message if the copy failed.
+ * \param[in] verify True to verify the copy.
+ *
+ */
+bool backupDatabase(const std::filesystem::path &database, std::filesystem::path &backup, QString &error, bool verify = false);
+
+/** \brief Callback of the SQLite log, receives the callback data, the error code and the message.
+ *
+ */
+using SQLiteLog = void (*)(void *data, int code, const char *message);
+
+/** \brief Configures SQLite in multithread mode with the given log callback, if any, and initializes
+ * the library. Must be called before any other use of SQLite. Returns true on success and false otherwise.
+ * \param[in] log Log callback or nullptr.
+ * \param[in] data Data passed to the log callback.
+ * \param[out] error Error message if SQLite couldn't be configured.
+ *
+ */
+bool initializeSQLite(SQLiteLog log, void *data, QString &error);
+
+/** \brief Opens the database and checks that it contains the Jellyfin items table. Returns the
+ * database handle or nullptr on error.
+ * \param[in] database Database file path.
+ * \param[out] error Error message if the database couldn't be opened.
+ *
+ */
+sqlite3 *openDatabase(const std::filesystem::path &database, QString &error);
+
+/** \brief Returns the path of the blurhash cache file in the user settings folder or empty if
+ * the folder can't be created.
+ *
+ */
+QString defaultBlurhashCacheFile();
+
+#endif // DATABASEUTILS_H_
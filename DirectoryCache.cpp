@@ -0,0 +1,131 @@
+/*
+ File: DirectoryCache.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <DirectoryCache.h>
+
+// C++
+#include <algorithm>
+
+//---------------------------------------------------------------
+DirectoryCache::DirectoryCache()
+: m_filesystemCalls{0}
+{
+}
+
+//---------------------------------------------------------------
+std::shared_ptr<const DirectoryListing> DirectoryCache::listing(const std::filesystem::path &folder)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_listings.find(folder);
+    if(it != m_listings.end()) return it->second;
+  }
+
+  // List outside the lock, if two threads list the same folder the first stored one is kept.
+  auto listing = std::make_shared<DirectoryListing>();
+
+  ++m_filesystemCalls;
+  std::error_code error;
+  std::filesystem::directory_iterator it{folder, error};
+  if(!error)
+  {
+    listing->exists = true;
+    for(; it != std::filesystem::directory_iterator(); it.increment(error))
+    {
+      listing->entries.push_back(it->path());
+      if(it->path().extension() == L".mp3")
+        listing->tracks.push_back(it->path());
+    }
+    std::sort(listing->tracks.begin(), listing->tracks.end());
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_listings.emplace(folder, listing).first->second;
+}
+
+//---------------------------------------------------------------
+std::filesystem::path DirectoryCache::image(const std::filesystem::path &folder, const std::string &name)
+{
+  const auto folderListing = listing(folder);
+
+  auto containsName = [&name](const std::filesystem::path &entry) { return entry.string().find(name) != std::string::npos; };
+  auto it = std::find_if(folderListing->entries.cbegin(), folderListing->entries.cend(), containsName);
+
+  return it == folderListing->entries.cend() ? std::filesystem::path() : *it;
+}
+
+//---------------------------------------------------------------
+std::filesystem::path DirectoryCache::defaultImage(const std::filesystem::path &folder)
+{
+  // Albums of the same artist share the parents, the result of every visited folder is kept.
+  std::vector<std::filesystem::path> visited;
+  std::filesystem::path result;
+
+  auto current = folder;
+  while(current != current.root_path())
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_defaults.find(current);
+      if(it != m_defaults.end())
+      {
+        result = it->second;
+        break;
+      }
+    }
+
+    visited.push_back(current);
+
+    auto candidate = current;
+    candidate /= "Default.png";
+    ++m_filesystemCalls;
+    std::error_code error;
+    if(std::filesystem::exists(candidate, error))
+    {
+      result = candidate;
+      break;
+    }
+
+    current = current.parent_path();
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for(const auto &path: visited)
+    m_defaults.emplace(path, result);
+
+  return result;
+}
+
+//---------------------------------------------------------------
+int DirectoryCache::trackPosition(const std::filesystem::path &track)
+{
+  const auto folderListing = listing(track.parent_path());
+  const auto &tracks = folderListing->tracks;
+
+  auto it = std::find(tracks.cbegin(), tracks.cend(), track);
+  return static_cast<int>(std::distance(tracks.cbegin(), it)) + 1;
+}
+
+//---------------------------------------------------------------
+size_t DirectoryCache::size()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_listings.size();
+}
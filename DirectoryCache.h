@@ -0,0 +1,109 @@
+/*
+ File: DirectoryCache.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DIRECTORYCACHE_H_
+#define DIRECTORYCACHE_H_
+
+// C++
+#include <atomic>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** \struct DirectoryListing
+ * \brief Snapshot of the contents of a folder.
+ *
+ */
+struct DirectoryListing
+{
+    bool                               exists;  /** true if the folder exists and could be listed. */
+    std::vector<std::filesystem::path> entries; /** folder entries in listing order. */
+    std::vector<std::filesystem::path> tracks;  /** mp3 files ordered by name. */
+
+    DirectoryListing()
+    : exists{false}
+    {};
+};
+
+/** \class DirectoryCache
+ * \brief Lists each folder once and shares the snapshot between all the queries of a
+ * process. Can be used concurrently from several threads.
+ *
+ */
+class DirectoryCache
+{
+  public:
+    /** \brief DirectoryCache class constructor.
+     *
+     */
+    DirectoryCache();
+
+    /** \brief Returns the listing of the given folder, listing it if not already done.
+     * \param[in] folder Folder path.
+     *
+     */
+    std::shared_ptr<const DirectoryListing> listing(const std::filesystem::path &folder);
+
+    /** \brief Returns the path of the first entry of the folder containing the given name
+     * or empty if none.
+     * \param[in] folder Folder path.
+     * \param[in] name Image file name or part of it.
+     *
+     */
+    std::filesystem::path image(const std::filesystem::path &folder, const std::string &name);
+
+    /** \brief Returns the path of the nearest "Default.png" image in the given folder or
+     * its parents, or empty if none.
+     * \param[in] folder Folder path.
+     *
+     */
+    std::filesystem::path defaultImage(const std::filesystem::path &folder);
+
+    /** \brief Returns the position of the track in the ordered mp3 files of its folder,
+     * starting at 1. Returns the number of mp3 files + 1 if not found.
+     * \param[in] track Track file path.
+     *
+     */
+    int trackPosition(const std::filesystem::path &track);
+
+    /** \brief Returns the number of listed folders.
+     *
+     */
+    size_t size();
+
+    /** \brief Returns the number of folder listings and file checks done.
+     *
+     */
+    unsigned long filesystemCalls() const
+    { return m_filesystemCalls; }
+
+  private:
+    using Listings = std::map<std::filesystem::path, std::shared_ptr<const DirectoryListing>>;
+    using Defaults = std::map<std::filesystem::path, std::filesystem::path>;
+
+    std::mutex                 m_mutex;           /** protects the maps. */
+    Listings                   m_listings;        /** listings by folder. */
+    Defaults                   m_defaults;        /** default image by folder. */
+    std::atomic<unsigned long> m_filesystemCalls; /** number of folder listings and file checks. */
+};
+
+#endif // DIRECTORYCACHE_H_
@@ -0,0 +1,296 @@
+/*
+ File: ImageLoader.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <ImageLoader.h>
+
+// Qt
+#include <QBuffer>
+#include <QImage>
+#include <QImageReader>
+
+// C++
+#include <limits>
+
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// stb_image, the images are always decoded from memory.
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_STDIO
+#include <blurhash/stb_image.h>
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#endif
+
+//---------------------------------------------------------------
+static bool isJpeg(const ImageFile &file)
+{
+  // Start of image marker followed by the start of the next marker.
+  return file.size() >= 3 && file.data()[0] == 0xFF && file.data()[1] == 0xD8 && file.data()[2] == 0xFF;
+}
+
+//---------------------------------------------------------------
+static bool loadScaledJpeg(const ImageFile &file, const ImageInfo &info, int denominator, DecodedImage &image)
+{
+  // The reader uses the file contents without copying them.
+  auto contents = QByteArray::fromRawData(reinterpret_cast<const char *>(file.data()), static_cast<int>(file.size()));
+  QBuffer buffer(&contents);
+
+  // The Qt JPEG plugin decodes at the libjpeg scale that gives at least the requested size,
+  // the size is rounded down so that scale is the denominator.
+  QImageReader reader(&buffer, "jpeg");
+  reader.setScaledSize(QSize(info.width / denominator, info.height / denominator));
+
+  auto decoded = reader.read();
+  if(decoded.isNull()) return false;
+
+  if(decoded.format() != QImage::Format_RGB888)
+  {
+    decoded = decoded.convertToFormat(QImage::Format_RGB888);
+    if(decoded.isNull()) return false;
+  }
+
+  // The pixels belong to the image, released with the last reference.
+  auto owner = std::make_shared<QImage>(std::move(decoded));
+  image.width = owner->width();
+  image.height = owner->height();
+  image.stride = owner->bytesPerLine();
+  image.pixels = std::shared_ptr<unsigned char>(owner, owner->bits());
+  image.scaled = true;
+
+  return true;
+}
+
+//---------------------------------------------------------------
+ImageFile::ImageFile(const std::filesystem::path &path, bool map)
+: m_file(QString::fromStdWString(path.wstring()))
+, m_data{nullptr}
+, m_size{0}
+, m_mapped{false}
+{
+  // Qt handles long and unicode paths on all the platforms.
+  if(!m_file.open(QIODevice::ReadOnly))
+  {
+    m_error = QString("Unable to open image <b>'%1'</b>: %2").arg(QString::fromStdWString(path.wstring())).arg(m_file.errorString());
+    return;
+  }
+
+  m_size = m_file.size();
+  if(m_size <= 0 || m_size > std::numeric_limits<int>::max())
+  {
+    m_error = QString("Invalid size of image <b>'%1'</b>.").arg(QString::fromStdWString(path.wstring()));
+    m_size = 0;
+    return;
+  }
+
+  if(map)
+  {
+    m_data = m_file.map(0, m_size);
+    m_mapped = (m_data != nullptr);
+  }
+
+  // Buffered read if the file can't be mapped.
+  if(!m_data)
+  {
+    m_buffer = m_file.readAll();
+    if(m_buffer.size() != m_size)
+    {
+      m_error = QString("Unable to read image <b>'%1'</b>: %2").arg(QString::fromStdWString(path.wstring())).arg(m_file.errorString());
+      m_buffer.clear();
+      m_size = 0;
+      return;
+    }
+
+    m_data = reinterpret_cast<const unsigned char *>(m_buffer.constData());
+  }
+}
+
+//---------------------------------------------------------------
+bool isNetworkFile(const std::filesystem::path &path)
+{
+#ifdef __linux__
+  struct statfs info;
+  if(statfs(path.c_str(), &info) != 0) return false;
+
+  // Magic numbers of the network filesystems in linux/magic.h.
+  switch(static_cast<unsigned long>(info.f_type))
+  {
+    case 0x6969:     // NFS
+    case 0x517B:     // SMB
+    case 0xFF534D42: // CIFS
+    case 0xFE534D42: // SMB2
+    case 0x564C:     // NCP
+    case 0x01021997: // V9FS
+    case 0x5346414F: // AFS
+      return true;
+    default:
+      return false;
+  }
+#elif defined(_WIN32)
+  // UNC paths or mapped network drives.
+  const auto root = path.root_name().wstring();
+  if(root.size() > 2 && root[0] == L'\\' && root[1] == L'\\') return true;
+
+  return !root.empty() && GetDriveTypeW((root + L"\\").c_str()) == DRIVE_REMOTE;
+#else
+  return false;
+#endif
+}
+
+//---------------------------------------------------------------
+bool probeImage(const ImageFile &file, ImageInfo &info)
+{
+  info = ImageInfo();
+
+  if(!file.isValid()) return false;
+  if(!stbi_info_from_memory(file.data(), static_cast<int>(file.size()), &info.width, &info.height, &info.components)) return false;
+
+  info.jpeg = isJpeg(file);
+
+  return true;
+}
+
+//---------------------------------------------------------------
+int jpegScaleDenominator(int width, int height, int minWidth, int minHeight)
+{
+  int denominator = 1;
+  while(denominator < 8 && width / (2 * denominator) >= minWidth && height / (2 * denominator) >= minHeight)
+    denominator *= 2;
+
+  return denominator;
+}
+
+//---------------------------------------------------------------
+bool loadImage(const ImageFile &file, const ImageInfo &info, int minWidth, int minHeight,
+               DecodedImage &image, QString &error)
+{
+  image = DecodedImage();
+
+  if(!file.isValid())
+  {
+    error = file.error();
+    return false;
+  }
+
+  if(info.jpeg)
+  {
+    const auto denominator = jpegScaleDenominator(info.width, info.height, minWidth, minHeight);
+    if(denominator > 1 && loadScaledJpeg(file, info, denominator, image)) return true;
+  }
+
+  int width, height, n;
+  unsigned char *data = stbi_load_from_memory(file.data(), static_cast<int>(file.size()), &width, &height, &n, 3);
+  if(!data)
+  {
+    error = QString("Unable to decode image: %1.").arg(QString::fromLatin1(stbi_failure_reason()));
+    return false;
+  }
+
+  image.width = width;
+  image.height = height;
+  image.stride = width * 3;
+  image.pixels = std::shared_ptr<unsigned char>(data, stbi_image_free);
+
+  return true;
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <blurhash/stb_image_write.h>
+
+#include <vector>
+
+TEST_CASE("jpeg scale denominator")
+{
+  CHECK(jpegScaleDenominator(3000, 3000, 128, 128) == 8);
+  CHECK(jpegScaleDenominator(800, 800, 128, 128) == 4);
+  CHECK(jpegScaleDenominator(512, 512, 128, 128) == 4);
+  CHECK(jpegScaleDenominator(511, 511, 128, 128) == 2);
+  CHECK(jpegScaleDenominator(200, 200, 128, 128) == 1);
+  CHECK(jpegScaleDenominator(3000, 300, 128, 128) == 2);
+}
+
+TEST_CASE("image probe and load")
+{
+  const auto folder = std::filesystem::temp_directory_path();
+  const auto jpegFile = folder / "JellyfinDBTweaker_ImageLoaderTest.jpg";
+  const auto pngFile = folder / "JellyfinDBTweaker_ImageLoaderTest.png";
+
+  const int width = 300, height = 200;
+  std::vector<unsigned char> pixels(width * height * 3, 128);
+  REQUIRE(stbi_write_jpg(jpegFile.string().c_str(), width, height, 3, pixels.data(), 90) != 0);
+  REQUIRE(stbi_write_png(pngFile.string().c_str(), width, height, 3, pixels.data(), width * 3) != 0);
+
+  ImageFile jpeg(jpegFile, true);
+  REQUIRE(jpeg.isValid());
+  CHECK(jpeg.isMapped());
+
+  ImageInfo info;
+  REQUIRE(probeImage(jpeg, info));
+  CHECK(info.width == width);
+  CHECK(info.height == height);
+  CHECK(info.components == 3);
+  CHECK(info.jpeg);
+
+  // Scaled if the JPEG plugin is available, full size otherwise.
+  QString error;
+  DecodedImage image;
+  REQUIRE(loadImage(jpeg, info, 64, 64, image, error));
+  CHECK(image.width >= 64);
+  CHECK(image.width <= width);
+  CHECK(image.height >= 64);
+  CHECK(image.stride >= image.width * 3);
+  CHECK(image.pixels);
+
+  // Buffered read.
+  ImageFile png(pngFile, false);
+  REQUIRE(png.isValid());
+  CHECK_FALSE(png.isMapped());
+
+  REQUIRE(probeImage(png, info));
+  CHECK(info.width == width);
+  CHECK_FALSE(info.jpeg);
+
+  REQUIRE(loadImage(png, info, 64, 64, image, error));
+  CHECK(image.width == width);
+  CHECK(image.height == height);
+  CHECK(image.stride == width * 3);
+  CHECK_FALSE(image.scaled);
+
+  ImageFile missing(folder / "JellyfinDBTweaker_ImageLoaderMissing.jpg", true);
+  CHECK_FALSE(missing.isValid());
+  CHECK_FALSE(missing.error().isEmpty());
+  CHECK_FALSE(probeImage(missing, info));
+  CHECK_FALSE(loadImage(missing, info, 64, 64, image, error));
+
+  std::filesystem::remove(jpegFile);
+  std::filesystem::remove(pngFile);
+}
+#endif
@@ -0,0 +1,165 @@
+/*
+ File: ImageLoader.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGELOADER_H_
+#define IMAGELOADER_H_
+
+// Qt
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+// C++
+#include <filesystem>
+#include <memory>
+
+/** \struct ImageInfo
+ * \brief Image properties read from the header of the image file.
+ *
+ */
+struct ImageInfo
+{
+    int  width;      /** image width in pixels. */
+    int  height;     /** image height in pixels. */
+    int  components; /** number of color components. */
+    bool jpeg;       /** true if the file is a JPEG image. */
+
+    ImageInfo()
+    : width{0}
+    , height{0}
+    , components{0}
+    , jpeg{false}
+    {};
+};
+
+/** \struct DecodedImage
+ * \brief RGB pixels of a decoded image with 3 bytes per pixel, the rows can be padded.
+ *
+ */
+struct DecodedImage
+{
+    int                            width;  /** decoded width in pixels. */
+    int                            height; /** decoded height in pixels. */
+    int                            stride; /** size in bytes of a row. */
+    std::shared_ptr<unsigned char> pixels; /** rgb pixels, released by the decoder. */
+    bool                           scaled; /** true if the image was decoded at a reduced scale. */
+
+    DecodedImage()
+    : width{0}
+    , height{0}
+    , stride{0}
+    , scaled{false}
+    {};
+};
+
+/** \class ImageFile
+ * \brief Contents of an image file, mapped read-only in memory or read in a buffer.
+ *
+ */
+class ImageFile
+{
+  public:
+    /** \brief ImageFile class constructor.
+     * \param[in] path Image file path.
+     * \param[in] map True to map the file in memory, false to read it.
+     *
+     */
+    ImageFile(const std::filesystem::path &path, bool map);
+
+    /** \brief Returns true if the contents are available and false otherwise.
+     *
+     */
+    bool isValid() const
+    { return m_data != nullptr; }
+
+    /** \brief Returns true if the file is mapped in memory and false if it was read.
+     *
+     */
+    bool isMapped() const
+    { return m_mapped; }
+
+    /** \brief Returns the file contents.
+     *
+     */
+    const unsigned char *data() const
+    { return m_data; }
+
+    /** \brief Returns the size of the file contents.
+     *
+     */
+    qint64 size() const
+    { return m_size; }
+
+    /** \brief Returns the error message or empty if none.
+     *
+     */
+    QString error() const
+    { return m_error; }
+
+  private:
+    QFile                m_file;   /** image file, unmaps the contents when destroyed. */
+    QByteArray           m_buffer; /** contents if the file is read. */
+    const unsigned char *m_data;   /** file contents. */
+    qint64               m_size;   /** size of the contents. */
+    bool                 m_mapped; /** true if the contents are mapped. */
+    QString              m_error;  /** error message or empty if none. */
+};
+
+/** \brief Returns true if the file is in a network filesystem, where mapping the file gives no
+ * benefit and the file can be changed under the mapping.
+ * \param[in] path File path.
+ *
+ */
+bool isNetworkFile(const std::filesystem::path &path);
+
+/** \brief Reads the size and components of the image from its header without decoding the pixels.
+ * Returns true on success and false if the format is not supported.
+ * \param[in] file Image file contents.
+ * \param[out] info Image properties.
+ *
+ */
+bool probeImage(const ImageFile &file, ImageInfo &info);
+
+/** \brief Returns the reduction of the JPEG scaled decoding, 1, 2, 4 or 8, that gives the smallest
+ * image not smaller than the given size.
+ * \param[in] width Image width.
+ * \param[in] height Image height.
+ * \param[in] minWidth Minimum width of the decoded image.
+ * \param[in] minHeight Minimum height of the decoded image.
+ *
+ */
+int jpegScaleDenominator(int width, int height, int minWidth, int minHeight);
+
+/** \brief Decodes the image to RGB. JPEG images are decoded at 1/2, 1/4 or 1/8 scale, downscaling
+ * in the DCT domain, if the result is not smaller than the given size. The rest of the formats, or
+ * if the scaled decoding fails, are decoded at full size with stb_image. Returns true on success and
+ * false otherwise. Can be called concurrently from several threads. The pixels don't reference the
+ * file contents.
+ * \param[in] file Image file contents.
+ * \param[in] info Image properties from probeImage().
+ * \param[in] minWidth Minimum width of the decoded image.
+ * \param[in] minHeight Minimum height of the decoded image.
+ * \param[out] image Decoded image.
+ * \param[out] error Error message if the image couldn't be decoded.
+ *
+ */
+bool loadImage(const ImageFile &file, const ImageInfo &info, int minWidth, int minHeight,
+               DecodedImage &image, QString &error);
+
+#endif // IMAGELOADER_H_
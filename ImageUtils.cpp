@@ -0,0 +1,234 @@
+/*
+ File: ImageUtils.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <ImageUtils.h>
+
+// C++
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#include <blurhash/blurhash.hpp>
+#endif
+
+namespace
+{
+  /** \struct Contribution
+   * \brief Weight of a source pixel in a destination pixel.
+   *
+   */
+  struct Contribution
+  {
+      int   source; /** source pixel index. */
+      float weight; /** normalized weight of the source pixel. */
+  };
+
+  //---------------------------------------------------------------
+  std::vector<std::vector<Contribution>> contributions(int srcSize, int dstSize)
+  {
+    std::vector<std::vector<Contribution>> result(dstSize);
+
+    const double ratio = static_cast<double>(srcSize) / dstSize;
+    for(int i = 0; i < dstSize; ++i)
+    {
+      const double start = i * ratio;
+      const double end = std::min<double>((i + 1) * ratio, srcSize);
+
+      for(int s = static_cast<int>(start); s < end; ++s)
+      {
+        const double weight = std::min<double>(end, s + 1) - std::max<double>(start, s);
+        if(weight > 0) result[i].push_back(Contribution{s, static_cast<float>(weight / ratio)});
+      }
+    }
+
+    return result;
+  }
+}
+
+//---------------------------------------------------------------
+std::pair<int, int> scaledSize(int width, int height, int maxSize)
+{
+  if(width <= maxSize && height <= maxSize) return std::make_pair(width, height);
+
+  if(width >= height)
+    return std::make_pair(maxSize, std::max(1, static_cast<int>(std::lround(static_cast<double>(height) * maxSize / width))));
+
+  return std::make_pair(std::max(1, static_cast<int>(std::lround(static_cast<double>(width) * maxSize / height))), maxSize);
+}
+
+//---------------------------------------------------------------
+RGBImage downscaleImage(const unsigned char *data, int width, int height, int stride, int dstWidth, int dstHeight)
+{
+  assert(data && dstWidth > 0 && dstHeight > 0 && dstWidth <= width && dstHeight <= height);
+
+  RGBImage image;
+  image.width = dstWidth;
+  image.height = dstHeight;
+  image.pixels.resize(dstWidth * dstHeight * 3);
+
+  const auto columns = contributions(width, dstWidth);
+  const auto rows = contributions(height, dstHeight);
+
+  // Horizontal pass of a source row, the last one is kept as consecutive destination rows
+  // can share the source row in the boundary.
+  std::vector<float> horizontal(dstWidth * 3);
+  int horizontalRow = -1;
+  auto filterRow = [&](int row)
+  {
+    if(row == horizontalRow) return;
+
+    const unsigned char *src = data + static_cast<size_t>(row) * stride;
+    for(int x = 0; x < dstWidth; ++x)
+    {
+      float r = 0, g = 0, b = 0;
+      for(const auto &c: columns[x])
+      {
+        r += src[3 * c.source + 0] * c.weight;
+        g += src[3 * c.source + 1] * c.weight;
+        b += src[3 * c.source + 2] * c.weight;
+      }
+      horizontal[3 * x + 0] = r;
+      horizontal[3 * x + 1] = g;
+      horizontal[3 * x + 2] = b;
+    }
+    horizontalRow = row;
+  };
+
+  std::vector<float> accumulated(dstWidth * 3);
+  for(int y = 0; y < dstHeight; ++y)
+  {
+    std::fill(accumulated.begin(), accumulated.end(), 0.f);
+
+    for(const auto &c: rows[y])
+    {
+      filterRow(c.source);
+      for(int i = 0; i < dstWidth * 3; ++i)
+        accumulated[i] += horizontal[i] * c.weight;
+    }
+
+    unsigned char *dst = image.pixels.data() + static_cast<size_t>(y) * dstWidth * 3;
+    for(int i = 0; i < dstWidth * 3; ++i)
+      dst[i] = static_cast<unsigned char>(std::clamp(std::lround(accumulated[i]), 0L, 255L));
+  }
+
+  return image;
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+TEST_CASE("scaled size")
+{
+  CHECK(scaledSize(3000, 3000, 128) == std::make_pair(128, 128));
+  CHECK(scaledSize(4000, 2000, 128) == std::make_pair(128, 64));
+  CHECK(scaledSize(1000, 3000, 128) == std::make_pair(43, 128));
+  CHECK(scaledSize(100, 50, 128) == std::make_pair(100, 50));
+}
+
+TEST_CASE("downscale averages covered pixels")
+{
+  // 4x2 image to 2x1, each destination pixel is the average of a 2x2 block.
+  const unsigned char data[] = { 0, 0, 0,   100, 100, 100,  10, 20, 30,  10, 20, 30,
+                                 100, 100, 100, 200, 200, 200,  30, 40, 50,  30, 40, 50 };
+
+  const auto image = downscaleImage(data, 4, 2, 12, 2, 1);
+  CHECK(image.width == 2);
+  CHECK(image.height == 1);
+  CHECK(image.pixels == std::vector<unsigned char>{100, 100, 100, 20, 30, 40});
+}
+
+namespace
+{
+  //---------------------------------------------------------------
+  std::vector<unsigned char> testCover(int width, int height)
+  {
+    std::vector<unsigned char> data(width * height * 3);
+    for(int y = 0; y < height; ++y)
+      for(int x = 0; x < width; ++x)
+      {
+        data[3 * (y * width + x) + 0] = static_cast<unsigned char>(255 * x / width);
+        data[3 * (y * width + x) + 1] = static_cast<unsigned char>(255 * y / height);
+        data[3 * (y * width + x) + 2] = static_cast<unsigned char>(128 + 127 * std::sin(x * 6.28 / width));
+      }
+
+    return data;
+  }
+
+  //---------------------------------------------------------------
+  int maxDecodedDifference(const std::string &first, const std::string &second)
+  {
+    const auto firstImage = blurhash::decode(first, 32, 32);
+    const auto secondImage = blurhash::decode(second, 32, 32);
+    REQUIRE(firstImage.image.size() == secondImage.image.size());
+
+    int maxDifference = 0;
+    for(size_t i = 0; i < firstImage.image.size(); ++i)
+      maxDifference = std::max(maxDifference, std::abs(firstImage.image[i] - secondImage.image[i]));
+
+    return maxDifference;
+  }
+}
+
+TEST_CASE("downscaled blurhash is close to full size blurhash")
+{
+  // Blurhash only keeps the low frequencies of the image, mostly preserved by the area filter.
+  // Quantization of the components can differ by a step, compare the decoded images instead.
+  const int width = 1280, height = 960;
+  const auto data = testCover(width, height);
+
+  const auto size = scaledSize(width, height, 128);
+  const auto image = downscaleImage(data.data(), width, height, width * 3, size.first, size.second);
+
+  const auto full = blurhash::encode(const_cast<unsigned char *>(data.data()), width, height, 5, 4);
+  const auto small = blurhash::encode(const_cast<unsigned char *>(image.pixels.data()), image.width, image.height, 5, 4);
+
+  // Same components, maximum AC value and DC (average color).
+  CHECK(full.substr(0, 6) == small.substr(0, 6));
+  CHECK(maxDecodedDifference(full, small) <= 12);
+
+  // Regression value of the 128 pixels working image, the same size Jellyfin uses.
+  CHECK(small == "V-HV9-2g$6SYn{hpa#fQf6fPgcfQfQfQfQi~a}fQfPfP");
+}
+
+TEST_CASE("resize path blurhash of a 2 megapixel cover")
+{
+  // Above a megapixel the full size hash can move the maximum AC value by one quantization
+  // step, which scales every AC component of the decoded image.
+  const int width = 1600, height = 1200;
+  const auto data = testCover(width, height);
+
+  const auto size = scaledSize(width, height, 128);
+  const auto image = downscaleImage(data.data(), width, height, width * 3, size.first, size.second);
+
+  const auto full = blurhash::encode(const_cast<unsigned char *>(data.data()), width, height, 5, 4);
+  const auto small = blurhash::encode(const_cast<unsigned char *>(image.pixels.data()), image.width, image.height, 5, 4);
+
+  // Same components and DC (average color).
+  CHECK(full[0] == small[0]);
+  CHECK(full.substr(2, 4) == small.substr(2, 4));
+  CHECK(maxDecodedDifference(full, small) <= 20);
+
+  CHECK(small == "V-HV9-2g$6SYn{hpa#fQf6fPgcfQfQfQfQi~a}fQfPfP");
+}
+#endif
@@ -0,0 +1,65 @@
+/*
+ File: ImageUtils.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef IMAGEUTILS_H_
+#define IMAGEUTILS_H_
+
+// C++
+#include <utility>
+#include <vector>
+
+/** \struct RGBImage
+ * \brief RGB image with 3 bytes per pixel and no padding between rows.
+ *
+ */
+struct RGBImage
+{
+    int width;                         /** image width in pixels. */
+    int height;                        /** image height in pixels. */
+    std::vector<unsigned char> pixels; /** rgb pixels, row-major. */
+
+    RGBImage()
+    : width{0}
+    , height{0}
+    {};
+};
+
+/** \brief Returns the size of the image scaled to fit in a square of the given size, keeping
+ * the aspect ratio. Images already smaller than the size are not scaled.
+ * \param[in] width Image width.
+ * \param[in] height Image height.
+ * \param[in] maxSize Maximum width and height of the scaled image.
+ *
+ */
+std::pair<int, int> scaledSize(int width, int height, int maxSize);
+
+/** \brief Downscales the given RGB image to the given size using an area (box) filter, each
+ * destination pixel being the average of the source pixels it covers. Destination size must not be
+ * bigger than the source size.
+ * \param[in] data RGB pixels of the source image.
+ * \param[in] width Source image width.
+ * \param[in] height Source image height.
+ * \param[in] stride Size in bytes of a source row.
+ * \param[in] dstWidth Destination image width.
+ * \param[in] dstHeight Destination image height.
+ *
+ */
+RGBImage downscaleImage(const unsigned char *data, int width, int height, int stride, int dstWidth, int dstHeight);
+
+#endif // IMAGEUTILS_H_
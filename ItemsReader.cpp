@@ -0,0 +1,137 @@
+/*
+ File: ItemsReader.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <ItemsReader.h>
+#include <JellyfinDefinitions.h>
+
+const std::string EMPTY_COLUMN = "EmptyPlaylist";
+const std::string CHANGED_COLUMN = "ChangedItem";
+
+//---------------------------------------------------------------
+ItemsReader::ItemsReader(sqlite3 *db, const std::string &where_sql, const std::string &watermark)
+: m_statement{nullptr}
+, m_pathIdx{-1}
+, m_typeIdx{-1}
+, m_idIdx{-1}
+, m_imagesIdx{-1}
+, m_albumIdx{-1}
+, m_artistsIdx{-1}
+, m_indexIdx{-1}
+, m_emptyIdx{-1}
+, m_changedIdx{-1}
+, m_rows{0}
+{
+  // The data BLOB is only compared, never returned. Without watermark all the items are changed.
+  const auto changed = watermark.empty() ? std::string("1") : std::string("COALESCE(") + MODIFIED_COLUMN + " > :watermark OR "
+                     + CREATED_COLUMN + " > :watermark, 0)";
+  const auto sql = std::string("SELECT ") + PATH_COLUMN + ", " + TYPE_COLUMN + ", " + ID_COLUMN + ", " + IMAGES_COLUMN + ", "
+                 + ALBUM_COLUMN + ", " + ARTISTS_COLUMN + ", " + INDEX_COLUMN + ", (" + TYPE_COLUMN + "='" + PLAYLIST_VALUE
+                 + "' AND data=X'" + EMPTY_PLAYLIST_BLOB + "') AS " + EMPTY_COLUMN + ", " + changed + " AS " + CHANGED_COLUMN
+                 + " FROM " + TABLE_NAME + where_sql;
+
+  auto result = sqlite3_prepare_v2(db, sql.c_str(), -1, &m_statement, nullptr);
+  if(result == SQLITE_OK && !watermark.empty())
+  {
+    result = sqlite3_bind_text(m_statement, sqlite3_bind_parameter_index(m_statement, ":watermark"), watermark.c_str(),
+                               watermark.length(), SQLITE_TRANSIENT);
+  }
+
+  if(result != SQLITE_OK)
+  {
+    m_error = QString("Unable to make SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errmsg(db)));
+    sqlite3_finalize(m_statement);
+    m_statement = nullptr;
+    return;
+  }
+
+  m_pathIdx = columnIndex(PATH_COLUMN);
+  m_typeIdx = columnIndex(TYPE_COLUMN);
+  m_idIdx = columnIndex(ID_COLUMN);
+  m_imagesIdx = columnIndex(IMAGES_COLUMN);
+  m_albumIdx = columnIndex(ALBUM_COLUMN);
+  m_artistsIdx = columnIndex(ARTISTS_COLUMN);
+  m_indexIdx = columnIndex(INDEX_COLUMN);
+  m_emptyIdx = columnIndex(EMPTY_COLUMN);
+  m_changedIdx = columnIndex(CHANGED_COLUMN);
+}
+
+//---------------------------------------------------------------
+ItemsReader::~ItemsReader()
+{
+  if(m_statement) sqlite3_finalize(m_statement);
+}
+
+//---------------------------------------------------------------
+int ItemsReader::columnIndex(const std::string &name)
+{
+  for(int i = 0; i < sqlite3_column_count(m_statement); ++i)
+  {
+    if(sqlite3_stricmp(sqlite3_column_name(m_statement, i), name.c_str()) == 0)
+      return i;
+  }
+
+  m_error = QString("Column '%1' not found in table '%2'.").arg(QString::fromStdString(name)).arg(QString::fromStdString(TABLE_NAME));
+  return -1;
+}
+
+//---------------------------------------------------------------
+bool ItemsReader::next(ItemData &item)
+{
+  if(!isValid()) return false;
+
+  const auto result = sqlite3_step(m_statement);
+  if(result != SQLITE_ROW)
+  {
+    if(result != SQLITE_DONE)
+    {
+      m_error = QString("Unable to finish step SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
+    }
+    return false;
+  }
+
+  auto text = [this](int idx)
+  {
+    const auto value = reinterpret_cast<const char *>(sqlite3_column_text(m_statement, idx));
+    return value ? std::string(value, sqlite3_column_bytes(m_statement, idx)) : std::string();
+  };
+
+  auto hasValue = [this](int idx)
+  { return sqlite3_column_type(m_statement, idx) != SQLITE_NULL; };
+
+  item.path = text(m_pathIdx);
+  item.id = text(m_idIdx);
+
+  const auto type = text(m_typeIdx);
+  if(type == PLAYLIST_VALUE)   item.type = ItemType::PLAYLIST;
+  else if(type == ALBUM_VALUE) item.type = ItemType::ALBUM;
+  else if(type == TRACK_VALUE) item.type = ItemType::TRACK;
+  else                         item.type = ItemType::UNKNOWN;
+
+  item.hasImages = hasValue(m_imagesIdx);
+  item.hasAlbum = hasValue(m_albumIdx);
+  item.hasArtists = hasValue(m_artistsIdx);
+  item.hasIndex = hasValue(m_indexIdx);
+  item.emptyPlaylist = sqlite3_column_int(m_statement, m_emptyIdx) != 0;
+  item.changed = sqlite3_column_int(m_statement, m_changedIdx) != 0;
+
+  ++m_rows;
+
+  return true;
+}
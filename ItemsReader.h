@@ -0,0 +1,133 @@
+/*
+ File: ItemsReader.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ITEMSREADER_H_
+#define ITEMSREADER_H_
+
+// Qt
+#include <QString>
+
+// SQLite3
+#include <sqlite3/sqlite3.h>
+
+// C++
+#include <string>
+
+/** \enum ItemType
+ * \brief Jellyfin item types handled by the application.
+ *
+ */
+enum class ItemType: char { PLAYLIST, ALBUM, TRACK, UNKNOWN };
+
+/** \struct ItemData
+ * \brief Projected row of the items table with only the values needed to generate the operations.
+ *
+ */
+struct ItemData
+{
+    std::string path;          /** item path. */
+    std::string id;            /** item id as used in playlists tracklists. */
+    ItemType    type;          /** item type. */
+    bool        hasImages;     /** true if the item has images metadata. */
+    bool        hasAlbum;      /** true if the item has album metadata. */
+    bool        hasArtists;    /** true if the item has artists metadata. */
+    bool        hasIndex;      /** true if the item has index number. */
+    bool        emptyPlaylist; /** true if the item is a playlist with empty data. */
+    bool        changed;       /** true if the item has been created or modified after the watermark. */
+
+    ItemData()
+    : type{ItemType::UNKNOWN}
+    , hasImages{false}
+    , hasAlbum{false}
+    , hasArtists{false}
+    , hasIndex{false}
+    , emptyPlaylist{false}
+    , changed{true}
+    {};
+};
+
+/** \class ItemsReader
+ * \brief Reads the items table selecting only the needed columns. Column indexes are
+ *  resolved by name once when the statement is prepared.
+ *
+ */
+class ItemsReader
+{
+  public:
+    /** \brief ItemsReader class constructor.
+     * \param[in] db SQLite db handle.
+     * \param[in] where_sql SQL statement starting with WHERE to select the rows.
+     * \param[in] watermark Creation or modification date of the items to consider them changed, empty
+     *                      to consider all the items changed.
+     *
+     */
+    explicit ItemsReader(sqlite3 *db, const std::string &where_sql, const std::string &watermark = std::string());
+
+    /** \brief ItemsReader class destructor.
+     *
+     */
+    ~ItemsReader();
+
+    /** \brief Returns true if the statement has been prepared and all the columns resolved.
+     *
+     */
+    bool isValid() const
+    { return m_statement && m_error.isEmpty(); }
+
+    /** \brief Reads the next row. Returns true if a row has been read and false at the
+     * end of the rows or on error.
+     * \param[out] item Item data of the row.
+     *
+     */
+    bool next(ItemData &item);
+
+    /** \brief Returns the number of rows read.
+     *
+     */
+    unsigned long rows() const
+    { return m_rows; }
+
+    /** \brief Returns the error text or empty if none.
+     *
+     */
+    QString error() const
+    { return m_error; }
+
+  private:
+    /** \brief Returns the index of the column with the given name or -1 if not found.
+     * \param[in] name Column name.
+     *
+     */
+    int columnIndex(const std::string &name);
+
+    sqlite3_stmt *m_statement;  /** SQLite statement. */
+    int           m_pathIdx;    /** index of path column. */
+    int           m_typeIdx;    /** index of type column. */
+    int           m_idIdx;      /** index of id column. */
+    int           m_imagesIdx;  /** index of images column. */
+    int           m_albumIdx;   /** index of album column. */
+    int           m_artistsIdx; /** index of artists column. */
+    int           m_indexIdx;   /** index of index number column. */
+    int           m_emptyIdx;   /** index of empty playlist computed column. */
+    int           m_changedIdx; /** index of changed item computed column. */
+    unsigned long m_rows;       /** number of rows read. */
+    QString       m_error;      /** error message or empty if none. */
+};
+
+#endif // ITEMSREADER_H_
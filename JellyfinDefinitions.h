@@ -0,0 +1,47 @@
+/*
+ File: JellyfinDefinitions.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef JELLYFINDEFINITIONS_H_
+#define JELLYFINDEFINITIONS_H_
+
+// C++
+#include <string>
+
+// Jellyfin database table and types to modify
+inline const std::string TABLE_NAME     = "TypedBaseItems";
+inline const std::string PLAYLIST_VALUE = "MediaBrowser.Controller.Playlists.Playlist";
+inline const std::string ALBUM_VALUE    = "MediaBrowser.Controller.Entities.Audio.MusicAlbum";
+inline const std::string TRACK_VALUE    = "MediaBrowser.Controller.Entities.Audio.Audio";
+
+// Jellyfin database columns used.
+inline const std::string PATH_COLUMN     = "Path";
+inline const std::string TYPE_COLUMN     = "type";
+inline const std::string ID_COLUMN       = "PresentationUniqueKey"; // Item id as used in playlists LinkedChildren.
+inline const std::string IMAGES_COLUMN   = "Images";
+inline const std::string ALBUM_COLUMN    = "Album";
+inline const std::string ARTISTS_COLUMN  = "Artists";
+inline const std::string INDEX_COLUMN    = "IndexNumber";
+inline const std::string CREATED_COLUMN  = "DateCreated";
+inline const std::string MODIFIED_COLUMN = "DateModified";
+
+// Empty Playlist data represented as BLOB and string.
+inline const std::string EMPTY_PLAYLIST_BLOB = "7b224f776e6572557365724964223a223030303030303030303030303030303030303030303030303030303030303030222c22536861726573223a5b5d2c22506c61796c6973744d6564696154797065223a22417564696f222c224973526f6f74223a66616c73652c224c696e6b65644368696c6472656e223a5b5d2c2249734844223a66616c73652c22497353686f7274637574223a66616c73652c225769647468223a302c22486569676874223a302c224578747261496473223a5b5d2c22446174654c6173745361766564223a22303030312d30312d30315430303a30303a30302e303030303030305a222c2252656d6f7465547261696c657273223a5b5d2c22537570706f72747345787465726e616c5472616e73666572223a66616c73657d";
+inline const std::string EMPTY_PLAYLIST_TEXT = "{\"OwnerUserId\":\"00000000000000000000000000000000\",\"Shares\":[],\"PlaylistMediaType\":\"Audio\",\"IsRoot\":false,\"LinkedChildren\":[],\"IsHD\":false,\"IsShortcut\":false,\"Width\":0,\"Height\":0,\"ExtraIds\":[],\"DateLastSaved\":\"0001-01-01T00:00:00.0000000Z\",\"RemoteTrailers\":[],\"SupportsExternalTransfer\":false}";
+
+#endif // JELLYFINDEFINITIONS_H_
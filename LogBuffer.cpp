@@ -0,0 +1,185 @@
+/*
+ File: LogBuffer.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <LogBuffer.h>
+
+// C++
+#include <algorithm>
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#endif
+
+//---------------------------------------------------------------
+LogBuffer::LogBuffer(size_t capacity)
+: m_records(std::max<size_t>(1, capacity))
+, m_first{0}
+, m_size{0}
+, m_dropped{0}
+, m_pendingDropped{0}
+, m_coalesced{0}
+{
+}
+
+//---------------------------------------------------------------
+void LogBuffer::push(const QString &text)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if(m_size > 0)
+  {
+    auto &last = m_records[(m_first + m_size - 1) % m_records.size()];
+    if(last.text == text)
+    {
+      ++last.count;
+      ++m_coalesced;
+      return;
+    }
+  }
+
+  if(m_size == m_records.size()) evict();
+
+  auto &record = m_records[(m_first + m_size) % m_records.size()];
+  record.text = text;
+  record.count = 1;
+  record.error = text.contains("color:#ff0000");
+  ++m_size;
+}
+
+//---------------------------------------------------------------
+void LogBuffer::evict()
+{
+  const auto capacity = m_records.size();
+
+  size_t victim = 0;
+  while(victim < m_size && m_records[(m_first + victim) % capacity].error) ++victim;
+  if(victim == m_size) victim = 0;
+
+  m_dropped += m_records[(m_first + victim) % capacity].count;
+  m_pendingDropped += m_records[(m_first + victim) % capacity].count;
+
+  // Move the older error records one place to keep the order.
+  for(size_t i = victim; i > 0; --i)
+    m_records[(m_first + i) % capacity] = std::move(m_records[(m_first + i - 1) % capacity]);
+
+  m_records[m_first] = LogRecord();
+  m_first = (m_first + 1) % capacity;
+  --m_size;
+}
+
+//---------------------------------------------------------------
+unsigned long LogBuffer::drain(std::vector<LogRecord> &records)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  records.reserve(records.size() + m_size);
+  for(size_t i = 0; i < m_size; ++i)
+  {
+    auto &record = m_records[(m_first + i) % m_records.size()];
+    records.push_back(std::move(record));
+    record = LogRecord();
+  }
+
+  m_first = (m_first + m_size) % m_records.size();
+  m_size = 0;
+
+  const auto dropped = m_pendingDropped;
+  m_pendingDropped = 0;
+
+  return dropped;
+}
+
+//---------------------------------------------------------------
+unsigned long LogBuffer::dropped() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_dropped;
+}
+
+//---------------------------------------------------------------
+unsigned long LogBuffer::coalesced() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_coalesced;
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+TEST_CASE("log buffer coalesces consecutive messages")
+{
+  LogBuffer buffer(4);
+  buffer.push("a");
+  buffer.push("a");
+  buffer.push("b");
+  buffer.push("a");
+
+  std::vector<LogRecord> records;
+  CHECK(buffer.drain(records) == 0);
+  REQUIRE(records.size() == 3);
+  CHECK(records[0].text == "a");
+  CHECK(records[0].count == 2);
+  CHECK(records[1].count == 1);
+  CHECK(records[2].text == "a");
+  CHECK(buffer.coalesced() == 1);
+  CHECK(buffer.dropped() == 0);
+}
+
+TEST_CASE("log buffer drops the oldest non-error records when full")
+{
+  const QString error = "<span style=\" color:#ff0000;\">error</span>";
+
+  LogBuffer buffer(3);
+  buffer.push("first");
+  buffer.push("first");
+  buffer.push(error);
+  buffer.push("second");
+  buffer.push("summary");
+
+  std::vector<LogRecord> records;
+  CHECK(buffer.drain(records) == 2);
+  REQUIRE(records.size() == 3);
+  CHECK(records[0].text == error);
+  CHECK(records[0].error);
+  CHECK(records[1].text == "second");
+  CHECK(records[2].text == "summary");
+  CHECK(buffer.dropped() == 2);
+
+  // Only errors left, the oldest one is dropped.
+  buffer.push(error + "1");
+  buffer.push(error + "2");
+  buffer.push(error + "3");
+  buffer.push("summary");
+
+  records.clear();
+  CHECK(buffer.drain(records) == 1);
+  REQUIRE(records.size() == 3);
+  CHECK(records[0].text == error + "2");
+  CHECK(records[1].text == error + "3");
+  CHECK(records[2].text == "summary");
+  CHECK(buffer.dropped() == 3);
+
+  records.clear();
+  CHECK(buffer.drain(records) == 0);
+  CHECK(records.empty());
+}
+#endif
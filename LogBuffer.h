@@ -0,0 +1,100 @@
+/*
+ File: LogBuffer.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LOGBUFFER_H_
+#define LOGBUFFER_H_
+
+// Qt
+#include <QString>
+
+// C++
+#include <mutex>
+#include <vector>
+
+/** \struct LogRecord
+ * \brief Log message and the number of consecutive times it was logged.
+ *
+ */
+struct LogRecord
+{
+    QString       text;  /** message text. */
+    unsigned long count; /** number of consecutive repetitions. */
+    bool          error; /** true if the message is an error (red) message. */
+
+    LogRecord()
+    : count{0}
+    , error{false}
+    {};
+};
+
+/** \class LogBuffer
+ * \brief Bounded ring buffer of log messages. Producers never wait for the consumer: consecutive
+ * repeated messages are coalesced and, when the buffer is full, the oldest non-error record is
+ * dropped to make room for the new message. Error records are only dropped if the buffer holds
+ * nothing else. The consumer drains the buffer in batches.
+ *
+ */
+class LogBuffer
+{
+  public:
+    /** \brief LogBuffer class constructor.
+     * \param[in] capacity Maximum number of records in the buffer.
+     *
+     */
+    explicit LogBuffer(size_t capacity = 4096);
+
+    /** \brief Adds a message to the buffer. Messages in a red span are errors.
+     * \param[in] text Message text.
+     *
+     */
+    void push(const QString &text);
+
+    /** \brief Moves the buffered records to the given vector and returns the number of messages
+     * dropped since the last call.
+     * \param[out] records Buffered records, oldest first.
+     *
+     */
+    unsigned long drain(std::vector<LogRecord> &records);
+
+    /** \brief Returns the total number of dropped messages.
+     *
+     */
+    unsigned long dropped() const;
+
+    /** \brief Returns the total number of messages coalesced with the previous one.
+     *
+     */
+    unsigned long coalesced() const;
+
+  private:
+    /** \brief Drops the oldest non-error record, or the oldest record if all of them are errors.
+     *
+     */
+    void evict();
+
+    mutable std::mutex     m_mutex;          /** protects the buffer, only held to copy a record. */
+    std::vector<LogRecord> m_records;        /** ring buffer. */
+    size_t                 m_first;          /** index of the oldest record. */
+    size_t                 m_size;           /** number of records in the buffer. */
+    unsigned long          m_dropped;        /** total dropped messages. */
+    unsigned long          m_pendingDropped; /** messages dropped since last drain. */
+    unsigned long          m_coalesced;      /** total coalesced messages. */
+};
+
+#endif // LOGBUFFER_H_
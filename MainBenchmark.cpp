@@ -0,0 +1,417 @@
+/*
+ File: MainBenchmark.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <ProcessThread.h>
+#include <DatabaseUtils.h>
+#include <JellyfinDefinitions.h>
+#include <LogBuffer.h>
+
+// Qt
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+
+// SQLite
+#include <sqlite3/sqlite3.h>
+
+// stb_image_write
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <blurhash/stb_image_write.h>
+
+// C++
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <vector>
+
+const QString VERSION = "1.0.1";
+
+/** \struct LibraryParameters
+ * \brief Contains the parameters of the synthetic library.
+ *
+ */
+struct LibraryParameters
+{
+    unsigned long albums;         /** number of album folders. */
+    unsigned long playlists;      /** number of albums with a playlist file. */
+    unsigned long emptyPlaylists; /** number of playlists with an empty tracklist. */
+    unsigned long discs;          /** maximum number of discs of an album. */
+    unsigned long tracks;         /** maximum number of tracks of a disc. */
+    unsigned long coverSize;      /** width and height of the cover images. */
+    unsigned long seed;           /** random generator seed. */
+    bool          pathIndex;      /** true to create the index on paths of Jellyfin databases. */
+};
+
+/** \struct LibraryStatistics
+ * \brief Contains the number of generated items of the synthetic library.
+ *
+ */
+struct LibraryStatistics
+{
+    unsigned long albums;     /** number of album rows and folders. */
+    unsigned long playlists;  /** number of playlist rows and files. */
+    unsigned long tracks;     /** number of track rows and files. */
+    unsigned long coverBytes; /** total size of the cover images. */
+
+    LibraryStatistics()
+    : albums{0}, playlists{0}, tracks{0}, coverBytes{0}
+    {};
+};
+
+//-----------------------------------------------------------------
+static std::string randomId(std::mt19937 &generator)
+{
+  static const char DIGITS[] = "0123456789abcdef";
+  std::uniform_int_distribution<int> digit(0, 15);
+
+  std::string id(32, '0');
+  for(auto &c: id) c = DIGITS[digit(generator)];
+
+  return id;
+}
+
+//-----------------------------------------------------------------
+static bool writeCover(const std::filesystem::path &file, unsigned long size, std::mt19937 &generator, unsigned long &bytes)
+{
+  // Gradient between two random colors with some noise, so the encoder has real work to do.
+  std::uniform_int_distribution<int> color(0, 255);
+  std::uniform_int_distribution<int> noise(-16, 16);
+  const int from[3]{color(generator), color(generator), color(generator)};
+  const int to[3]{color(generator), color(generator), color(generator)};
+
+  std::vector<unsigned char> pixels(size * size * 3);
+  for(unsigned long y = 0; y < size; ++y)
+  {
+    for(unsigned long x = 0; x < size; ++x)
+    {
+      const double t = static_cast<double>(x + y) / (2 * size);
+      for(int c = 0; c < 3; ++c)
+      {
+        const int value = static_cast<int>(from[c] + t * (to[c] - from[c])) + noise(generator);
+        pixels[(y * size + x) * 3 + c] = static_cast<unsigned char>(std::clamp(value, 0, 255));
+      }
+    }
+  }
+
+  std::ofstream stream(file, std::ios::binary);
+  if(!stream) return false;
+
+  auto writeFunc = [](void *context, void *data, int length)
+  {
+    reinterpret_cast<std::ofstream *>(context)->write(reinterpret_cast<const char *>(data), length);
+  };
+
+  const auto result = stbi_write_jpg_to_func(writeFunc, &stream, size, size, 3, pixels.data(), 90);
+  bytes += stream.tellp();
+
+  return result != 0 && stream.good();
+}
+
+//-----------------------------------------------------------------
+static bool createFile(const std::filesystem::path &file)
+{
+  std::ofstream stream(file, std::ios::binary);
+  return stream.good();
+}
+
+
+//-----------------------------------------------------------------
+static bool generateLibrary(const std::filesystem::path &folder, const LibraryParameters &parameters, LibraryStatistics &statistics, QString &error)
+{
+  std::mt19937 generator(parameters.seed);
+
+  sqlite3 *db = nullptr;
+  const auto dbFile = (folder / "library.db").string();
+  auto result = sqlite3_open_v2(dbFile.c_str(), &db, SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE, nullptr);
+  if(result != SQLITE_OK)
+  {
+    error = QString("Unable to create database. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
+    sqlite3_close(db);
+    return false;
+  }
+
+  auto exec = [db, &error](const std::string &sql)
+  {
+    const auto code = sqlite3_exec(db, sql.c_str(), nullptr, nullptr, nullptr);
+    if(code != SQLITE_OK)
+      error = QString("Unable to execute '%1'. SQLite3 error: %2").arg(QString::fromStdString(sql)).arg(QString::fromLatin1(sqlite3_errmsg(db)));
+    return code == SQLITE_OK;
+  };
+
+  // Subset of the columns of the Jellyfin items table, only the ones used by the process.
+  std::string sql = "CREATE TABLE " + TABLE_NAME + " (guid GUID PRIMARY KEY NOT NULL, " + TYPE_COLUMN + " TEXT NOT NULL, data BLOB NULL, "
+                  + PATH_COLUMN + " TEXT NULL, " + ID_COLUMN + " TEXT NULL, " + IMAGES_COLUMN + " TEXT NULL, " + ALBUM_COLUMN + " TEXT NULL, "
+                  + ARTISTS_COLUMN + " TEXT NULL, AlbumArtists TEXT NULL, " + INDEX_COLUMN + " INT NULL, MediaType TEXT NULL, "
+                  + CREATED_COLUMN + " DATETIME NULL, " + MODIFIED_COLUMN + " DATETIME NULL)";
+
+  bool ok = exec(sql);
+  if(ok && parameters.pathIndex)
+    ok = exec("CREATE INDEX idx_PathTypedBaseItems ON " + TABLE_NAME + "(" + PATH_COLUMN + ")");
+
+  sqlite3_stmt *statement = nullptr;
+  if(ok)
+  {
+    sql = "INSERT INTO " + TABLE_NAME + " (guid, " + TYPE_COLUMN + ", data, " + PATH_COLUMN + ", " + ID_COLUMN + ", MediaType, "
+          + CREATED_COLUMN + ", " + MODIFIED_COLUMN + ") VALUES (:guid, :type, :data, :path, :id, :media, "
+          "strftime('%Y-%m-%d %H:%M:%f', 'now'), strftime('%Y-%m-%d %H:%M:%f', 'now'))";
+    result = sqlite3_prepare_v2(db, sql.c_str(), -1, &statement, nullptr);
+    if(result != SQLITE_OK)
+    {
+      error = QString("Unable to make SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errmsg(db)));
+      ok = false;
+    }
+  }
+
+  auto insert = [&](const std::string &type, const std::string &data, const std::filesystem::path &path, const char *media)
+  {
+    const auto guid = randomId(generator);
+    const auto id = randomId(generator);
+    const auto pathText = path.string();
+
+    sqlite3_reset(statement);
+    sqlite3_bind_text(statement, 1, guid.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(statement, 2, type.c_str(), -1, SQLITE_TRANSIENT);
+    if(data.empty()) sqlite3_bind_null(statement, 3);
+    else sqlite3_bind_blob(statement, 3, data.data(), data.size(), SQLITE_TRANSIENT);
+    sqlite3_bind_text(statement, 4, pathText.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(statement, 5, id.c_str(), -1, SQLITE_TRANSIENT);
+    if(media) sqlite3_bind_text(statement, 6, media, -1, SQLITE_STATIC);
+    else sqlite3_bind_null(statement, 6);
+
+    const auto code = sqlite3_step(statement);
+    if(code != SQLITE_DONE)
+      error = QString("Unable to insert item. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errmsg(db)));
+    return code == SQLITE_DONE;
+  };
+
+  // Playlists that are not empty only need to be different from the empty playlist blob.
+  const std::string PLAYLIST_TEXT = "{\"PlaylistMediaType\":\"Audio\",\"LinkedChildren\":[{\"Type\":\"Manual\"}]}";
+
+  std::uniform_int_distribution<unsigned long> discsDistribution(1, std::max(1ul, parameters.discs));
+  std::uniform_int_distribution<unsigned long> tracksDistribution(std::max(1ul, parameters.tracks / 2), std::max(1ul, parameters.tracks));
+
+  ok = ok && exec("BEGIN TRANSACTION");
+
+  for(unsigned long i = 0; ok && i < parameters.albums; ++i)
+  {
+    const auto name = std::string("Artist ") + std::to_string(i / 4 + 1) + " - Album " + std::to_string(i + 1);
+    const auto albumFolder = folder / name;
+
+    std::error_code ec;
+    if(!std::filesystem::create_directories(albumFolder, ec))
+    {
+      error = QString("Unable to create folder '%1'.").arg(QString::fromStdWString(albumFolder.wstring()));
+      ok = false;
+      break;
+    }
+
+    if(!writeCover(albumFolder / "Frontal.jpg", parameters.coverSize, generator, statistics.coverBytes))
+    {
+      error = QString("Unable to write cover of '%1'.").arg(QString::fromStdWString(albumFolder.wstring()));
+      ok = false;
+      break;
+    }
+
+    ok = insert(ALBUM_VALUE, std::string(), albumFolder, nullptr);
+    ++statistics.albums;
+
+    const auto discs = discsDistribution(generator);
+    for(unsigned long disc = 1; ok && disc <= discs; ++disc)
+    {
+      const auto tracks = tracksDistribution(generator);
+      for(unsigned long track = 1; ok && track <= tracks; ++track)
+      {
+        const auto number = std::string(track < 10 ? "0" : "") + std::to_string(track);
+        const auto trackFile = albumFolder / (std::to_string(disc) + "-" + number + " - Song " + number + ".mp3");
+
+        ok = createFile(trackFile) && insert(TRACK_VALUE, std::string(), trackFile, "Audio");
+        ++statistics.tracks;
+      }
+    }
+
+    if(ok && i < parameters.playlists)
+    {
+      const auto playlistFile = albumFolder / (name + ".m3u");
+      const auto &data = (i < parameters.emptyPlaylists) ? EMPTY_PLAYLIST_TEXT : PLAYLIST_TEXT;
+
+      ok = createFile(playlistFile) && insert(PLAYLIST_VALUE, data, playlistFile, "Audio");
+      ++statistics.playlists;
+    }
+
+    if(!ok && error.isEmpty()) error = QString("Unable to create files in '%1'.").arg(QString::fromStdWString(albumFolder.wstring()));
+  }
+
+  sqlite3_finalize(statement);
+  ok = ok && exec("COMMIT");
+  sqlite3_close(db);
+
+  return ok;
+}
+
+//-----------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("jellyfin-db-tweaker-benchmark");
+  QCoreApplication::setApplicationVersion(VERSION);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Generates a synthetic Jellyfin library, runs the process on it and prints the duration "
+                                   "of each phase as JSON to the standard output.");
+  parser.addHelpOption();
+  parser.addVersionOption();
+
+  const QCommandLineOption albumsOption("albums", "Number of album folders.", "number", "200");
+  const QCommandLineOption playlistsOption("playlists", "Number of albums with a playlist.", "number", "200");
+  const QCommandLineOption emptyOption("empty-playlists", "Number of playlists with an empty tracklist.", "number", "100");
+  const QCommandLineOption discsOption("discs", "Maximum number of discs per album.", "number", "3");
+  const QCommandLineOption tracksOption("tracks", "Maximum number of tracks per disc.", "number", "14");
+  const QCommandLineOption coverOption("cover-size", "Width and height of the cover images.", "pixels", "500");
+  const QCommandLineOption seedOption("seed", "Random generator seed.", "number", "1");
+  const QCommandLineOption noDbIndexOption("no-db-index", "Don't create the index on paths that Jellyfin databases have.");
+  const QCommandLineOption threadsOption("threads", "Number of threads to compute the images, 0 for all the cores.", "number", "0");
+  const QCommandLineOption sizeOption("blurhash-size", "Maximum size of the image used to compute the blurhash.", "pixels", "128");
+  const QCommandLineOption bulkOption("bulk-profile", "Tune the database connection for bulk updates during the run.");
+  const QCommandLineOption dryRunOption("dry-run", "Write the planned changes to 'plan.tsv' in the library folder instead of updating the database.");
+  const QCommandLineOption cacheOption("cache", "Blurhash cache file, by default the cache is disabled.", "file");
+  const QCommandLineOption folderOption("folder", "Empty folder for the library, by default a temporary folder that is removed at exit.", "folder");
+
+  parser.addOptions({albumsOption, playlistsOption, emptyOption, discsOption, tracksOption, coverOption, seedOption,
+                     noDbIndexOption, threadsOption, sizeOption, bulkOption, dryRunOption, cacheOption, folderOption});
+  parser.process(app);
+
+  bool ok = true;
+  auto number = [&parser, &ok](const QCommandLineOption &option)
+  {
+    bool valid = false;
+    const auto value = parser.value(option).toULong(&valid);
+    ok &= valid;
+    return value;
+  };
+
+  LibraryParameters parameters;
+  parameters.albums = number(albumsOption);
+  parameters.playlists = std::min(parameters.albums, number(playlistsOption));
+  parameters.emptyPlaylists = std::min(parameters.playlists, number(emptyOption));
+  parameters.discs = number(discsOption);
+  parameters.tracks = number(tracksOption);
+  parameters.coverSize = number(coverOption);
+  parameters.seed = number(seedOption);
+  parameters.pathIndex = !parser.isSet(noDbIndexOption);
+
+  ProcessConfiguration config;
+  config.imageName = "Frontal";
+  config.threads = number(threadsOption);
+  config.blurhashImageSize = number(sizeOption);
+  config.cacheFile = parser.value(cacheOption);
+  config.bulkProfile = parser.isSet(bulkOption);
+  config.dryRun = parser.isSet(dryRunOption);
+
+  if(!ok || parameters.coverSize == 0 || config.blurhashImageSize <= 0)
+  {
+    std::cerr << "Invalid numeric option value." << std::endl;
+    return 1;
+  }
+
+  QTemporaryDir temporary;
+  std::filesystem::path folder;
+  if(parser.isSet(folderOption))
+  {
+    folder = std::filesystem::path(parser.value(folderOption).toStdWString());
+  }
+  else
+  {
+    if(!temporary.isValid())
+    {
+      std::cerr << "Unable to create temporary folder." << std::endl;
+      return 1;
+    }
+    folder = std::filesystem::path(temporary.path().toStdWString());
+  }
+
+  QJsonObject summary;
+  QJsonObject library;
+  library["albums"] = static_cast<qint64>(parameters.albums);
+  library["playlists"] = static_cast<qint64>(parameters.playlists);
+  library["emptyPlaylists"] = static_cast<qint64>(parameters.emptyPlaylists);
+  library["discs"] = static_cast<qint64>(parameters.discs);
+  library["tracks"] = static_cast<qint64>(parameters.tracks);
+  library["coverSize"] = static_cast<qint64>(parameters.coverSize);
+  library["seed"] = static_cast<qint64>(parameters.seed);
+  library["pathIndex"] = parameters.pathIndex;
+  summary["version"] = VERSION;
+  summary["library"] = library;
+  summary["threads"] = static_cast<qint64>(config.threads);
+  summary["blurhashSize"] = config.blurhashImageSize;
+  summary["bulkProfile"] = config.bulkProfile;
+  summary["dryRun"] = config.dryRun;
+
+  auto finish = [&summary](int code, const QString &error)
+  {
+    summary["error"] = error;
+    std::cout << QJsonDocument(summary).toJson(QJsonDocument::Indented).toStdString();
+    return code;
+  };
+
+  QString error;
+  if(!initializeSQLite(nullptr, nullptr, error)) return finish(2, error);
+
+  QElapsedTimer timer;
+  timer.start();
+
+  LibraryStatistics statistics;
+  if(!generateLibrary(folder, parameters, statistics, error)) return finish(2, error);
+
+  QJsonObject generation;
+  generation["milliseconds"] = timer.nsecsElapsed() / 1000000.0;
+  generation["albums"] = static_cast<qint64>(statistics.albums);
+  generation["playlists"] = static_cast<qint64>(statistics.playlists);
+  generation["tracks"] = static_cast<qint64>(statistics.tracks);
+  generation["coverBytes"] = static_cast<qint64>(statistics.coverBytes);
+  summary["generation"] = generation;
+
+  config.planFile = QString::fromStdWString((folder / "plan.tsv").wstring());
+
+  auto db = openDatabase(folder / "library.db", error);
+  if(!db) return finish(2, error);
+
+  // Log messages are not printed, when full the buffer drops the oldest non-error ones.
+  LogBuffer logBuffer;
+
+  timer.restart();
+  ProcessThread process(db, config, logBuffer);
+  process.start();
+  process.wait();
+  const double milliseconds = timer.nsecsElapsed() / 1000000.0;
+
+  summary["metrics"] = process.metrics().toJson();
+  summary["milliseconds"] = milliseconds;
+  summary["operations"] = static_cast<qint64>(process.totalOperations());
+
+  sqlite3_close(db);
+  sqlite3_shutdown();
+
+  return finish(process.error().isEmpty() ? 0 : 3, process.error());
+}
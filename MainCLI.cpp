@@ -0,0 +1,279 @@
+/*
+ File: MainCLI.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <ProcessThread.h>
+#include <DatabaseUtils.h>
+#include <LogBuffer.h>
+#include <ChangeJournal.h>
+
+// Qt
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+
+// SQLite
+#include <sqlite3/sqlite3.h>
+
+// C++
+#include <iostream>
+#include <vector>
+
+/** Process exit codes. */
+enum ExitCode: int { SUCCESS = 0, INVALID_ARGUMENTS = 1, DATABASE_ERROR = 2, PROCESS_ERROR = 3 };
+
+const QString VERSION = "1.0.1";
+
+// Interval in ms to print the log messages of the process.
+const unsigned long LOG_INTERVAL = 200;
+
+//-----------------------------------------------------------------
+static QString plainText(const QString &html)
+{
+  static const QRegularExpression tags("<[^>]*>");
+
+  auto text = html;
+  text.remove(tags);
+  text.replace("&quot;", "\"").replace("&lt;", "<").replace("&gt;", ">").replace("&amp;", "&");
+
+  return text;
+}
+
+//-----------------------------------------------------------------
+static void printLog(LogBuffer &buffer, bool quiet)
+{
+  std::vector<LogRecord> records;
+  const auto dropped = buffer.drain(records);
+  if(quiet) return;
+
+  for(const auto &record: records)
+  {
+    std::cerr << plainText(record.text).toStdString();
+    if(record.count > 1) std::cerr << " (repeated " << record.count << " times)";
+    std::cerr << std::endl;
+  }
+
+  if(dropped > 0) std::cerr << dropped << " log messages dropped." << std::endl;
+}
+
+//-----------------------------------------------------------------
+static void sqlite3_log_callback(void *ptr, int iErrCode, const char *zMsg)
+{
+  auto buffer = reinterpret_cast<LogBuffer *>(ptr);
+  if(buffer && iErrCode != SQLITE_OK)
+    buffer->push(QString("<span style=\" color:#ff0000;\">sqlite3 log: %1</span>").arg(QString::fromLatin1(zMsg)));
+}
+
+//-----------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+  QCoreApplication::setApplicationName("jellyfin-db-tweaker-cli");
+  QCoreApplication::setApplicationVersion(VERSION);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Enters missing metadata in a Jellyfin database. Prints the log to the standard error "
+                                   "and a JSON summary to the standard output.");
+  parser.addHelpOption();
+  parser.addVersionOption();
+  parser.addPositionalArgument("database", "Jellyfin library database file.");
+
+  const QCommandLineOption noImagesOption("no-playlist-images", "Don't compute playlists images and artist/album metadata.");
+  const QCommandLineOption noTracklistOption("no-tracklists", "Don't add the tracklist to empty playlists.");
+  const QCommandLineOption noArtistsOption("no-artists", "Don't add artist and album metadata to the tracks.");
+  const QCommandLineOption noNumbersOption("no-track-numbers", "Don't add the track number to the tracks.");
+  const QCommandLineOption noAlbumsOption("no-albums", "Don't add image, artist and album metadata to the albums.");
+  const QCommandLineOption imageOption("image-name", "Name or part of the name of the album cover files.", "name", "Frontal");
+  const QCommandLineOption threadsOption("threads", "Number of threads to compute the images, 0 for all the cores.", "number", "0");
+  const QCommandLineOption sizeOption("blurhash-size", "Maximum size of the image used to compute the blurhash.", "pixels", "128");
+  const QCommandLineOption rowsOption("batch-rows", "Maximum number of updates per transaction, 0 for no limit.", "number", "5000");
+  const QCommandLineOption bytesOption("batch-bytes", "Maximum bytes written per transaction, 0 for no limit.", "bytes", "16777216");
+  const QCommandLineOption queueOption("queue-depth", "Maximum number of chunks of generated operations waiting to be written.", "number", "8");
+  const QCommandLineOption noIndexOption("no-path-index", "Don't create a temporary index on paths if the database has none. The "
+                                         "index left by an aborted run is removed anyway.");
+  const QCommandLineOption cacheOption("cache", "Blurhash cache file, empty to disable the cache.", "file", defaultBlurhashCacheFile());
+  const QCommandLineOption bulkOption("bulk-profile", "Tune the database connection for bulk updates during the run.");
+  const QCommandLineOption metricsOption("metrics", "File to write the metrics of the run as JSON.", "file");
+  const QCommandLineOption verifyOption("verify-backup", "Verify the copy of the database with a checksum of its pages.");
+  const QCommandLineOption dryRunOption("dry-run", "Don't modify the database, write the planned changes to a tab separated file.", "file");
+  const QCommandLineOption journalOption("journal", "Write the previous values of the modified rows to a journal file "
+                                          "instead of copying the database.", "file");
+  const QCommandLineOption stateOption("state", "Run state file, items that failed in the last run are skipped while "
+                                        "they and their folders don't change.", "file");
+  const QCommandLineOption rollbackOption("rollback", "Undo the changes of a journal file and exit.", "file");
+  const QCommandLineOption noBackupOption("no-backup", "Don't make a copy of the database before modifying it.");
+  const QCommandLineOption quietOption(QStringList{"q", "quiet"}, "Don't print the log.");
+
+  parser.addOptions({noImagesOption, noTracklistOption, noArtistsOption, noNumbersOption, noAlbumsOption, imageOption,
+                     threadsOption, sizeOption, rowsOption, bytesOption, queueOption, noIndexOption, cacheOption, bulkOption, metricsOption,
+                     verifyOption, dryRunOption, journalOption, stateOption, rollbackOption, noBackupOption, quietOption});
+  parser.process(app);
+
+  const auto arguments = parser.positionalArguments();
+  if(arguments.size() != 1)
+  {
+    std::cerr << "A single database file must be given." << std::endl;
+    return INVALID_ARGUMENTS;
+  }
+
+  bool ok = true;
+  auto number = [&parser, &ok](const QCommandLineOption &option)
+  {
+    bool valid = false;
+    const auto value = parser.value(option).toULong(&valid);
+    ok &= valid;
+    return value;
+  };
+
+  ProcessConfiguration config;
+  config.processPlaylistImages = !parser.isSet(noImagesOption);
+  config.processPlaylistTracklist = !parser.isSet(noTracklistOption);
+  config.processTracksArtists = !parser.isSet(noArtistsOption);
+  config.processTracksNumbers = !parser.isSet(noNumbersOption);
+  config.processAlbums = !parser.isSet(noAlbumsOption);
+  config.imageName = parser.value(imageOption);
+  config.threads = number(threadsOption);
+  config.blurhashImageSize = number(sizeOption);
+  config.batchRows = number(rowsOption);
+  config.batchBytes = number(bytesOption);
+  config.queueDepth = number(queueOption);
+  config.pathIndex = !parser.isSet(noIndexOption);
+  config.cacheFile = parser.value(cacheOption);
+  config.metricsFile = parser.value(metricsOption);
+  config.bulkProfile = parser.isSet(bulkOption);
+  config.dryRun = parser.isSet(dryRunOption);
+  config.planFile = parser.value(dryRunOption);
+  config.journalFile = parser.value(journalOption);
+  config.stateFile = parser.value(stateOption);
+
+  if(!ok || config.blurhashImageSize <= 0 || config.queueDepth == 0)
+  {
+    std::cerr << "Invalid numeric option value." << std::endl;
+    return INVALID_ARGUMENTS;
+  }
+
+  // Without syncs the database can be corrupted by a crash and only a copy can restore it.
+  if(!config.journalFile.isEmpty() && config.bulkProfile)
+  {
+    std::cerr << "The bulk maintenance profile needs a copy of the database, it can't be used with a journal." << std::endl;
+    return INVALID_ARGUMENTS;
+  }
+
+  if(parser.isSet(noBackupOption) && config.bulkProfile)
+  {
+    std::cerr << "The bulk maintenance profile needs a copy of the database, it can't be used without a backup." << std::endl;
+    return INVALID_ARGUMENTS;
+  }
+
+  if(!config.processTracksArtists && !config.processPlaylistImages)
+  {
+    std::cerr << "At least updating artists/albums or images metadata must be enabled!" << std::endl;
+    return INVALID_ARGUMENTS;
+  }
+
+  const bool quiet = parser.isSet(quietOption);
+  const std::filesystem::path dbFile(arguments.first().toStdWString());
+
+  LogBuffer logBuffer;
+  QJsonObject summary;
+  summary["database"] = QString::fromStdWString(dbFile.wstring());
+
+  auto finish = [&summary](int code, const QString &error)
+  {
+    summary["exitCode"] = code;
+    summary["error"] = error;
+    std::cout << QJsonDocument(summary).toJson(QJsonDocument::Indented).toStdString();
+    return code;
+  };
+
+  QString error;
+  if(!initializeSQLite(sqlite3_log_callback, &logBuffer, error)) return finish(DATABASE_ERROR, error);
+
+  if(parser.isSet(rollbackOption))
+  {
+    auto db = openDatabase(dbFile, error);
+    if(!db) return finish(DATABASE_ERROR, error);
+
+    unsigned long long changes = 0, conflicts = 0;
+    const auto journal = std::filesystem::path(parser.value(rollbackOption).toStdWString());
+    const bool success = ChangeJournal::rollback(db, journal, changes, conflicts, error);
+    sqlite3_close(db);
+    sqlite3_shutdown();
+
+    QJsonObject rollback;
+    rollback["journal"] = parser.value(rollbackOption);
+    rollback["changes"] = static_cast<qint64>(changes);
+    rollback["conflicts"] = static_cast<qint64>(conflicts);
+    summary["rollback"] = rollback;
+
+    return finish(success ? SUCCESS : DATABASE_ERROR, error);
+  }
+
+  // A dry run doesn't modify the database and the journal replaces the copy.
+  if(!parser.isSet(noBackupOption) && !config.dryRun && config.journalFile.isEmpty())
+  {
+    std::filesystem::path backupDb;
+    if(!backupDatabase(dbFile, backupDb, error, parser.isSet(verifyOption))) return finish(DATABASE_ERROR, error);
+
+    summary["backup"] = QString::fromStdWString(backupDb.wstring());
+  }
+
+  auto db = openDatabase(dbFile, error);
+  if(!db) return finish(DATABASE_ERROR, error);
+
+  QElapsedTimer timer;
+  timer.start();
+
+  ProcessThread process(db, config, logBuffer);
+  process.start();
+  while(!process.wait(LOG_INTERVAL))
+    printLog(logBuffer, quiet);
+  printLog(logBuffer, quiet);
+
+  const double seconds = timer.nsecsElapsed() / 1000000000.0;
+
+  QJsonObject items;
+  items["playlists"] = static_cast<qint64>(process.items().playlists.size());
+  items["tracklists"] = static_cast<qint64>(process.items().tracklists.size());
+  items["tracks"] = static_cast<qint64>(process.items().tracks.size());
+  items["albums"] = static_cast<qint64>(process.items().albums.size());
+
+  summary["items"] = items;
+  summary["operations"] = static_cast<qint64>(process.operations());
+  summary["totalOperations"] = static_cast<qint64>(process.totalOperations());
+  summary["seconds"] = seconds;
+  summary["modified"] = process.hasModifiedDB();
+  if(config.dryRun) summary["plan"] = config.planFile;
+  if(!config.journalFile.isEmpty() && !config.dryRun) summary["journal"] = config.journalFile;
+  summary["metrics"] = process.metrics().toJson();
+  summary["logDropped"] = static_cast<qint64>(logBuffer.dropped());
+
+  const auto result = sqlite3_close(db);
+  if(result != SQLITE_OK && process.error().isEmpty())
+  {
+    return finish(DATABASE_ERROR, QString("Unable to close database. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result))));
+  }
+
+  sqlite3_shutdown();
+
+  return finish(process.error().isEmpty() ? SUCCESS : PROCESS_ERROR, process.error());
+}
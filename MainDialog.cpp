@@ -21,6 +21,9 @@
 #include <MainDialog.h>
 #include <AboutDialog.h>
 #include <ProcessThread.h>
+#include <DatabaseUtils.h>
+#include <BackupThread.h>
+#include <ChangeJournal.h>
 
 // Qt
 #include <QFileDialog>
@@ -29,36 +32,44 @@
 #include <QTextBlock>
 #include <QSettings>
 #include <QDir>
-#include <QDateTime>
+#include <QStringList>
+#include <QTime>
 #include <QtWinExtras/QWinTaskbarProgress>
 
 // C++
 #include <filesystem>
-#include <mutex>
+#include <vector>
+#include <algorithm>
 // For debug
 //#include <iostream>
 
-const std::string TABLE_NAME = "TypedBaseItems";
-
 QString currentPath = QDir::currentPath();
 
-std::mutex log_mutex;
-
 // Configuration registry keys.
 const QString DATABASE_KEY = "Database";
 const QString MODIFY_ARTIST = "Modify artist and albums";
 const QString MODIFY_IMAGES = "Modify images";
 const QString IMAGES_NAME = "Images filename";
+const QString BULK_PROFILE = "Bulk maintenance profile";
+const QString VERIFY_BACKUP = "Verify database copy";
+const QString DRY_RUN = "Dry run";
+const QString JOURNAL = "Journal instead of copy";
+const QString INCREMENTAL = "Incremental";
+
+// Interval in ms to print the buffered log messages.
+const int LOG_INTERVAL = 100;
+
+// Interval in ms to update the progress.
+const int PROGRESS_INTERVAL = 50;
 
 //---------------------------------------------------------------
 void sqlite3_log_callback(void *ptr, int iErrCode, const char *zMsg)
 {
-  std::lock_guard<std::mutex> lg(log_mutex);
-
+  // Can be called from any thread, the message is printed by the dialog later.
   auto obj = reinterpret_cast<MainDialog *>(ptr);
   if(obj && iErrCode != SQLITE_OK)
   {
-    obj->log(QString("<span style=\" color:#ff0000;\">sqlite3 log: %1</span>").arg(QString::fromLatin1(zMsg)));
+    obj->logBuffer().push(QString("<span style=\" color:#ff0000;\">sqlite3 log: %1</span>").arg(QString::fromLatin1(zMsg)));
     //std::cerr << "SQLITE3 ERROR: " << zMsg << std::endl;
   }
 }
@@ -69,19 +80,23 @@ MainDialog::MainDialog(QWidget *p, Qt::WindowFlags f)
 , m_sql3Handle{nullptr}
 , m_thread{nullptr}
 , m_taskBarButton{nullptr}
+, m_logDropped{0}
+, m_logCoalesced{0}
 {
   setupUi(this);
 
   connectSignals();
 
-  sqlite3_initialize();
-  sqlite3_config(SQLITE_CONFIG_MULTITHREAD);
-  sqlite3_config(SQLITE_CONFIG_LOG, sqlite3_log_callback, this);
+  QString error;
+  if(!initializeSQLite(sqlite3_log_callback, this, error))
+    showErrorMessage("Error initializing SQLite", error);
 
   qRegisterMetaType<QTextBlock>("QTextBlock");
   qRegisterMetaType<QTextCursor>("QTextCursor");
 
   loadSettings();
+
+  m_logTimer.start(LOG_INTERVAL);
 }
 
 //---------------------------------------------------------------
@@ -89,13 +104,21 @@ MainDialog::~MainDialog()
 {
   if(m_thread)
   {
+    // The process stops its secondary threads on abort, it can't be terminated.
     m_thread->abort();
-    m_thread->wait(1000);
-    if(m_thread->isRunning()) m_thread->terminate();
+    m_thread->wait();
 
     m_thread = nullptr;
   }
 
+  if(m_backupThread)
+  {
+    disconnect(m_backupThread.get(), SIGNAL(finished()), this, SLOT(onBackupThreadFinished()));
+    m_backupThread->abort();
+    m_backupThread->wait();
+    m_backupThread = nullptr;
+  }
+
   closeDatabase();
 
   sqlite3_shutdown();
@@ -112,6 +135,9 @@ void MainDialog::connectSignals()
   connect(m_aboutButton, SIGNAL(pressed()), this, SLOT(onAboutButtonPressed()));
   connect(m_openDBButton, SIGNAL(pressed()), this, SLOT(onFileButtonPressed()));
   connect(m_updateButton, SIGNAL(pressed()), this, SLOT(onUpdateButtonPressed()));
+  connect(m_rollbackButton, SIGNAL(pressed()), this, SLOT(onRollbackButtonPressed()));
+  connect(&m_logTimer, SIGNAL(timeout()), this, SLOT(onLogTimer()));
+  connect(&m_progressTimer, SIGNAL(timeout()), this, SLOT(onProgressTimer()));
 }
 
 //---------------------------------------------------------------
@@ -162,6 +188,12 @@ void MainDialog::onUpdateButtonPressed()
 
       if(m_thread) return;
 
+      if(m_journal->isChecked() && m_bulkProfile->isChecked())
+      {
+        showErrorMessage("Error updating database", "The bulk maintenance profile needs a copy of the database, it can't be used with a journal.");
+        return;
+      }
+
       ProcessConfiguration config;
       config.processPlaylistImages = m_playlistImages->isChecked();
       config.processPlaylistTracklist = m_trackList->isChecked();
@@ -169,16 +201,35 @@ void MainDialog::onUpdateButtonPressed()
       config.processTracksNumbers = m_trackNumbers->isChecked();
       config.processAlbums = m_albumMetadata->isChecked();
       config.imageName = m_imageName->text();
+      config.bulkProfile = m_bulkProfile->isChecked();
+      config.dryRun = m_dryRun->isChecked();
+
+      const auto dbPath = std::filesystem::path(QString::fromUtf8(sqlite3_db_filename(m_sql3Handle, "main")).toStdWString());
+      if(config.dryRun)
+        config.planFile = QString::fromStdWString(planFileName(dbPath).wstring());
+      else if(m_journal->isChecked())
+        config.journalFile = QString::fromStdWString(journalFileName(dbPath).wstring());
+
+      if(m_incremental->isChecked())
+        config.stateFile = QString::fromStdWString(stateFileName(dbPath).wstring());
 
-      m_thread = std::make_shared<ProcessThread>(m_sql3Handle, config, this);
+      config.cacheFile = defaultBlurhashCacheFile();
+
+      m_thread = std::make_shared<ProcessThread>(m_sql3Handle, config, m_logBuffer, this);
 
       button->setText("Cancel");
       button->setToolTip("Cancel the update process.");
       m_quitButton->setEnabled(false);
+      m_rollbackButton->setEnabled(false);
 
-      connect(m_thread.get(), SIGNAL(progress(int)), this, SLOT(onProgressUpdated(int)));
       connect(m_thread.get(), SIGNAL(finished()), this, SLOT(onProcessThreadFinished()));
-      connect(m_thread.get(), SIGNAL(message(const QString &)), this, SLOT(log(const QString &)), Qt::BlockingQueuedConnection);
+
+      m_estimator.reset();
+      m_elapsed.start();
+      m_progressTimer.start(PROGRESS_INTERVAL);
+
+      m_logDropped = m_logBuffer.dropped();
+      m_logCoalesced = m_logBuffer.coalesced();
 
       m_thread->start();
       m_metadata->setEnabled(false);
@@ -192,14 +243,11 @@ void MainDialog::onUpdateButtonPressed()
 
       if(!m_thread) return;
 
-      if(m_thread->isRunning())
-      {
-        m_thread->abort();
-        m_thread->wait(1000);
-      }
-      if(m_thread->isRunning()) m_thread->terminate();
+      // The process stops its secondary threads on abort and commits the operations already
+      // applied, terminating it would leave them running.
+      m_thread->abort();
+      m_thread->wait();
 
-      m_thread->wait(1000);
       m_metadata->setEnabled(true);
 
       QApplication::restoreOverrideCursor();
@@ -229,15 +277,62 @@ void MainDialog::closeDatabase()
 }
 
 //---------------------------------------------------------------
-void MainDialog::onProgressUpdated(int value)
+void MainDialog::onProgressTimer()
 {
+  if(m_backupThread)
+  {
+    const auto total = m_backupThread->totalPages();
+    if(total == 0) return;
+
+    const int value = static_cast<int>((static_cast<long long>(m_backupThread->copiedPages()) * 100) / total);
+    m_progressBar->setValue(value);
+    m_progressBar->setFormat("Copying database - %p%");
+    m_taskBarButton->progress()->setValue(value);
+    return;
+  }
+
+  if(!m_thread) return;
+
+  const auto total = m_thread->totalOperations();
+  if(total == 0) return;
+
+  const auto operations = std::min(m_thread->operations(), total);
+  m_estimator.addSample(m_elapsed.nsecsElapsed() / 1000000000.0, operations);
+
+  const int value = static_cast<int>((operations * 100) / total);
   m_progressBar->setValue(value);
   m_taskBarButton->progress()->setValue(value);
+
+  const auto remaining = m_estimator.remaining(total);
+  if(remaining >= 0)
+  {
+    const auto remainingTime = QTime(0, 0).addSecs(static_cast<int>(remaining)).toString("hh:mm:ss");
+    m_progressBar->setFormat(QString("%p% - %1 operations/s - %2 remaining").arg(m_estimator.rate(), 0, 'f', 1).arg(remainingTime));
+  }
 }
 
 //---------------------------------------------------------------
 void MainDialog::onProcessThreadFinished()
 {
+  m_progressTimer.stop();
+
+  onLogTimer();
+
+  const double seconds = m_elapsed.nsecsElapsed() / 1000000000.0;
+  if(m_thread->operations() > 0 && seconds > 0)
+  {
+    log(QString("Processed %1 operations in %2 seconds, %3 operations/s.").arg(m_thread->operations())
+          .arg(seconds, 0, 'f', 2).arg(m_thread->operations() / seconds, 0, 'f', 1));
+  }
+
+  // The buffer counters are totals of all the processes of the dialog.
+  const auto coalesced = m_logBuffer.coalesced() - m_logCoalesced;
+  const auto dropped = m_logBuffer.dropped() - m_logDropped;
+  if(dropped > 0 || coalesced > 0)
+  {
+    log(QString("Log messages repeated: %1, dropped: %2.").arg(coalesced).arg(dropped));
+  }
+
   if(m_thread->isAborted())
   {
     log(QString("Database update process aborted! Database %1 been modified.").arg(m_thread->hasModifiedDB() ? "HAS":"HAS NOT"));
@@ -252,7 +347,10 @@ void MainDialog::onProcessThreadFinished()
 
   m_updateButton->setText("Update DB");
   m_quitButton->setEnabled(true);
+  m_rollbackButton->setEnabled(true);
   m_progressBar->setValue(0);
+  m_progressBar->setFormat("%p%");
+  m_taskBarButton->progress()->setValue(0);
 }
 
 //---------------------------------------------------------------
@@ -289,110 +387,170 @@ void MainDialog::onFileButtonPressedImplementation()
 
   log(QString("Selected database: ") + qdbFile);
 
-  std::filesystem::path backupDb = dbFile.parent_path();
-  currentPath = QString::fromStdString(backupDb.string());
-
-  auto currentTime = QDateTime::currentDateTime().toString("dd_MM_yyyy-hh_mm_ss");
+  currentPath = QString::fromStdString(dbFile.parent_path().string());
 
-  backupDb /= dbFile.stem();
-  backupDb += std::string("_backup-") + currentTime.toStdString() + dbFile.extension().string();
+  if(m_journal->isChecked())
+  {
+    log("Database not copied, the changes of the updates will be written to a journal.");
 
-  const auto qBackupDb = QString::fromStdWString(backupDb.wstring());
-  log(QString("Attempting to copy database"));
+    m_DatabasePath->setText(qdbFile);
+    if(openSelectedDatabase(dbFile))
+    {
+      m_DatabasePath->setEnabled(false);
+      m_openDBButton->setEnabled(false);
+      m_verifyBackup->setEnabled(false);
+      m_journal->setEnabled(false);
+    }
 
-  if(std::filesystem::exists(backupDb))
-  {
     QApplication::restoreOverrideCursor();
-    showErrorMessage("Error making backup", QString("Unable to backup file: '%1' to '%2'. Destination file exists!").arg(qdbFile).arg(qBackupDb));
     return;
   }
 
-  if(!std::filesystem::copy_file(dbFile, backupDb))
-  {
-    QApplication::restoreOverrideCursor();
-    showErrorMessage("Error making backup", QString("Unable to backup file: '%1' to '%2'. Unable to copy.").arg(qdbFile).arg(qBackupDb));
-    return;
-  }
+  log(QString("Attempting to copy database%1").arg(m_verifyBackup->isChecked() ? " and verify the copy" : ""));
 
-  log(QString("Database copied to: %1").arg(qBackupDb));
+  // The copy is done in a thread, the database is opened when it finishes.
+  m_backupThread = std::make_shared<BackupThread>(dbFile, m_verifyBackup->isChecked(), this);
+  connect(m_backupThread.get(), SIGNAL(finished()), this, SLOT(onBackupThreadFinished()));
 
-  // Try to open with sqlite to test if db is locked.
-  auto result = sqlite3_open(dbFile.string().c_str(), &m_sql3Handle);
-  if(result != SQLITE_OK)
-  {
-    QApplication::restoreOverrideCursor();
-    const auto msg = QString("Unable to open database: '%1'. SQLite3 error: %2").arg(qdbFile)
-                         .arg(QString::fromLatin1(sqlite3_errstr(result)));
-    showErrorMessage("Error opening database", msg);
+  m_DatabasePath->setText(qdbFile);
+  m_DatabasePath->setEnabled(false);
+  m_openDBButton->setEnabled(false);
+  m_verifyBackup->setEnabled(false);
+  m_journal->setEnabled(false);
+  m_progressBar->setEnabled(true);
 
-    closeDatabase();
-    std::filesystem::remove(backupDb);
-    return;
-  }
+  m_elapsed.start();
+  m_progressTimer.start(PROGRESS_INTERVAL);
+  m_backupThread->start();
 
-  sqlite3_stmt *stmt;
-  result = sqlite3_prepare_v2(m_sql3Handle, "SELECT * FROM sqlite_master where type='table'", -1, &stmt, nullptr);
-  if (result != SQLITE_OK)
-  {
-    QApplication::restoreOverrideCursor();
-    const auto msg = QString("Unable to make SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
-    showErrorMessage("Error opening database", msg);
+  QApplication::restoreOverrideCursor();
+}
 
-    closeDatabase();
-    std::filesystem::remove(backupDb);
-    return;
-  }
+//---------------------------------------------------------------
+void MainDialog::onBackupThreadFinished()
+{
+  m_progressTimer.stop();
+  m_progressBar->setValue(0);
+  m_progressBar->setFormat("%p%");
+  m_taskBarButton->progress()->setValue(0);
 
-  bool hasTable = false;
-  while ((result = sqlite3_step(stmt)) == SQLITE_ROW)
-  {
-    auto name = reinterpret_cast<const char *>(sqlite3_column_text(stmt, 1));
-    if(TABLE_NAME.compare(name) == 0)
-    {
-      hasTable = true;
-      result = SQLITE_DONE;
-      break;
-    }
-  }
+  const auto dbFile = m_backupThread->database();
+  const auto backupDb = m_backupThread->backup();
+  QString error = m_backupThread->error();
+  m_backupThread = nullptr;
 
-  if (result != SQLITE_DONE)
+  auto restoreUi = [this]()
   {
-    QApplication::restoreOverrideCursor();
-    const auto msg = QString("Unable to finish SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
-    showErrorMessage("Error opening database", msg);
-    sqlite3_finalize(stmt);
+    m_DatabasePath->setEnabled(true);
+    m_openDBButton->setEnabled(true);
+    m_verifyBackup->setEnabled(true);
+    m_journal->setEnabled(true);
+    m_progressBar->setEnabled(false);
+  };
+
+  if(!error.isEmpty())
+  {
+    restoreUi();
+    showErrorMessage("Error making backup", error);
     return;
   }
 
-  sqlite3_finalize(stmt);
+  const double seconds = m_elapsed.nsecsElapsed() / 1000000000.0;
+  std::error_code errorCode;
+  const auto megabytes = std::filesystem::file_size(backupDb, errorCode) / (1024.0 * 1024.0);
+  log(QString("Database copied%1 to: %2 in %3 seconds (%4 MB/s).").arg(m_verifyBackup->isChecked() ? " and verified" : "")
+        .arg(QString::fromStdWString(backupDb.wstring())).arg(seconds, 0, 'f', 2).arg(seconds > 0 ? megabytes / seconds : 0, 0, 'f', 1));
 
-  if(!hasTable)
+  if(!openSelectedDatabase(dbFile))
   {
-    QApplication::restoreOverrideCursor();
-    showErrorMessage("Error opening database", QString("Database: '%1' doesn't contain the correct tables.").arg(qdbFile));
+    restoreUi();
+    std::filesystem::remove(backupDb, errorCode);
+  }
+}
 
-    closeDatabase();
-    std::filesystem::remove(backupDb);
-    return;
+//---------------------------------------------------------------
+bool MainDialog::openSelectedDatabase(const std::filesystem::path &dbFile)
+{
+  QString error;
+  m_sql3Handle = openDatabase(dbFile, error);
+  if(!m_sql3Handle)
+  {
+    showErrorMessage("Error opening database", error);
+    return false;
   }
 
   log(QString("Database contains the correct tables. Database opened."));
 
   // Success, modify UI
-  m_DatabasePath->setText(qdbFile);
-  m_DatabasePath->setEnabled(false);
-  m_openDBButton->setEnabled(false);
-  m_progressBar->setEnabled(true);
   m_metadata->setEnabled(true);
   m_updateButton->setEnabled(true);
+  m_rollbackButton->setEnabled(true);
+
+  return true;
+}
+
+//---------------------------------------------------------------
+void MainDialog::onRollbackButtonPressed()
+{
+  if(m_thread || !m_sql3Handle) return;
+
+  const auto qJournal = QFileDialog::getOpenFileName(this, "Select changes journal", currentPath,
+                                                     tr("Changes journal (*.changeset)"), nullptr, QFileDialog::ReadOnly);
+  if(qJournal.isEmpty()) return;
+
+  QApplication::changeOverrideCursor(Qt::WaitCursor);
+
+  // The journal is proportional to the size of the changes, it's applied in the dialog thread.
+  QString error;
+  unsigned long long changes = 0, conflicts = 0;
+  const bool success = ChangeJournal::rollback(m_sql3Handle, std::filesystem::path(qJournal.toStdWString()), changes, conflicts, error);
+
+  QApplication::restoreOverrideCursor();
+
+  if(!success)
+  {
+    showErrorMessage("Error undoing changes", error);
+    return;
+  }
+
+  log(QString("Undone the changes of journal <b>'%1'</b>: %2 rows restored.").arg(qJournal).arg(changes));
+  if(conflicts > 0)
+  {
+    log(QString("<span style=\" color:#ff0000;\"><b>%1</b> rows modified after the update have not been restored.</span>").arg(conflicts));
+  }
 }
 
 //---------------------------------------------------------------
 void MainDialog::log(const QString &msg)
 {
+  onLogTimer();
+
   m_log->append(msg);
 }
 
+//---------------------------------------------------------------
+void MainDialog::onLogTimer()
+{
+  std::vector<LogRecord> records;
+  const auto dropped = m_logBuffer.drain(records);
+  if(records.empty() && dropped == 0) return;
+
+  // A single append for all the buffered messages.
+  QStringList lines;
+  for(const auto &record: records)
+  {
+    if(record.count > 1)
+      lines << QString("%1 <i>(repeated %2 times)</i>").arg(record.text).arg(record.count);
+    else
+      lines << record.text;
+  }
+
+  if(dropped > 0)
+    lines << QString("<span style=\" color:#ff0000;\"><b>%1</b> log messages dropped.</span>").arg(dropped);
+
+  m_log->append(lines.join("<br>"));
+}
+
 //---------------------------------------------------------------
 void MainDialog::showErrorMessage(const QString title, const QString text)
 {
@@ -416,6 +574,11 @@ void MainDialog::saveSettings()
   settings.setValue(MODIFY_ARTIST, m_artistAndAlbums->isChecked());
   settings.setValue(MODIFY_IMAGES, m_playlistImages->isChecked());
   settings.setValue(IMAGES_NAME, m_imageName->text());
+  settings.setValue(BULK_PROFILE, m_bulkProfile->isChecked());
+  settings.setValue(VERIFY_BACKUP, m_verifyBackup->isChecked());
+  settings.setValue(DRY_RUN, m_dryRun->isChecked());
+  settings.setValue(JOURNAL, m_journal->isChecked());
+  settings.setValue(INCREMENTAL, m_incremental->isChecked());
 
   settings.sync();
 }
@@ -432,6 +595,11 @@ void MainDialog::loadSettings()
   m_artistAndAlbums->setChecked(settings.value(MODIFY_ARTIST, true).toBool());
   m_playlistImages->setChecked(settings.value(MODIFY_IMAGES, true).toBool());
   m_imageName->setText(settings.value(IMAGES_NAME, "Frontal").toString());
+  m_bulkProfile->setChecked(settings.value(BULK_PROFILE, false).toBool());
+  m_verifyBackup->setChecked(settings.value(VERIFY_BACKUP, false).toBool());
+  m_dryRun->setChecked(settings.value(DRY_RUN, false).toBool());
+  m_journal->setChecked(settings.value(JOURNAL, false).toBool());
+  m_incremental->setChecked(settings.value(INCREMENTAL, false).toBool());
 }
 
 //---------------------------------------------------------------
@@ -22,18 +22,24 @@
 
 // Qt
 #include <QDialog>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QtWinExtras/QWinTaskbarButton>
 
 // Project
 #include <ui_MainDialog.h>
+#include <LogBuffer.h>
+#include <ProgressEstimator.h>
 
 // sqlite3
 #include <sqlite3/sqlite3.h>
 
 // C++
+#include <filesystem>
 #include <memory>
 
 class ProcessThread;
+class BackupThread;
 
 /** \class MainDialog
  * \brief Program dialog
@@ -58,11 +64,17 @@ class MainDialog
     virtual ~MainDialog();
 
   public slots:
-    /** \brief Prints the given message in the log widget.
+    /** \brief Prints the given message in the log widget, after the buffered messages.
      *
      */
     void log(const QString &msg);
 
+    /** \brief Returns the buffer of the messages logged from other threads.
+     *
+     */
+    LogBuffer &logBuffer()
+    { return m_logBuffer; }
+
   private slots:
     /** \brief Exits the application.
      *
@@ -85,16 +97,31 @@ class MainDialog
      */
     void onUpdateButtonPressed();
 
-    /** \brief Updates progress bar.
+    /** \brief Selects a journal file and undoes its changes.
+     *
+     */
+    void onRollbackButtonPressed();
+
+    /** \brief Updates the progress bar with the progress of the processing thread.
      *
      */
-    void onProgressUpdated(int);
+    void onProgressTimer();
 
     /** \brief Shows the results and deletes the processing thread.
      *
      */
     void onProcessThreadFinished();
 
+    /** \brief Opens the database if the copy has been successful and deletes the backup thread.
+     *
+     */
+    void onBackupThreadFinished();
+
+    /** \brief Prints the buffered log messages in the log widget.
+     *
+     */
+    void onLogTimer();
+
   protected:
     virtual void showEvent(QShowEvent *e) override final;
 
@@ -114,6 +141,13 @@ class MainDialog
      */
     void onFileButtonPressedImplementation();
 
+    /** \brief Helper method to open the selected database and enable the update. Returns true
+     * on success and false otherwise.
+     * \param[in] dbFile Database file path.
+     *
+     */
+    bool openSelectedDatabase(const std::filesystem::path &dbFile);
+
     /** \brief Helper method to save application configuration to the registry.
      *
      */
@@ -133,7 +167,15 @@ class MainDialog
 
     sqlite3                       *m_sql3Handle;    /** SQLite db handle */
     std::shared_ptr<ProcessThread> m_thread;        /** Thread to process database. */
+    std::shared_ptr<BackupThread>  m_backupThread;  /** Thread to copy the database before opening it. */
     QWinTaskbarButton             *m_taskBarButton; /** taskbar progress widget. */
+    LogBuffer                      m_logBuffer;     /** messages logged from other threads. */
+    QTimer                         m_logTimer;      /** timer to print the buffered messages. */
+    QTimer                         m_progressTimer; /** timer to update the progress. */
+    QElapsedTimer                  m_elapsed;       /** time since the start of the process or the copy. */
+    ProgressEstimator              m_estimator;     /** process rate and remaining time. */
+    unsigned long                  m_logDropped;    /** dropped messages before the current process. */
+    unsigned long                  m_logCoalesced;  /** coalesced messages before the current process. */
 };
 
 #endif // MAINDIALOG_H_
@@ -0,0 +1,204 @@
+/*
+ File: Metrics.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <Metrics.h>
+
+// Qt
+#include <QJsonArray>
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#endif
+
+// Names of the timers and counters in the summary and JSON.
+const char *const TIMER_NAMES[Metrics::TIMERS] = { "findImage", "stat", "decode", "downscale", "encode" };
+const char *const COUNTER_NAMES[Metrics::COUNTERS] = { "rowsScanned", "rowsUpdated", "filesystemCalls", "sqliteSteps",
+                                                       "arenaBytes", "scaledDecodes" };
+
+//---------------------------------------------------------------
+Metrics::Metrics()
+{
+  reset();
+}
+
+//---------------------------------------------------------------
+void Metrics::reset()
+{
+  m_phases.clear();
+
+  for(int i = 0; i < TIMERS; ++i)
+  {
+    m_nanoseconds[i] = 0;
+    m_calls[i] = 0;
+  }
+
+  for(int i = 0; i < COUNTERS; ++i)
+    m_counters[i] = 0;
+}
+
+//---------------------------------------------------------------
+void Metrics::addPhase(const std::string &name, double milliseconds)
+{
+  m_phases.push_back(PhaseTime{name, milliseconds});
+}
+
+//---------------------------------------------------------------
+void Metrics::addTime(Timer timer, std::chrono::nanoseconds duration)
+{
+  m_nanoseconds[timer].fetch_add(duration.count(), std::memory_order_relaxed);
+  m_calls[timer].fetch_add(1, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------
+void Metrics::add(Counter counter, unsigned long value)
+{
+  m_counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+//---------------------------------------------------------------
+double Metrics::milliseconds(Timer timer) const
+{
+  return m_nanoseconds[timer] / 1000000.0;
+}
+
+//---------------------------------------------------------------
+unsigned long Metrics::calls(Timer timer) const
+{
+  return m_calls[timer];
+}
+
+//---------------------------------------------------------------
+unsigned long Metrics::value(Counter counter) const
+{
+  return m_counters[counter];
+}
+
+//---------------------------------------------------------------
+QString Metrics::summary() const
+{
+  // Image steps are computed in several threads, their times are the sum of all the threads.
+  QString text = QString("%1 %2\n").arg("Phase", -36).arg("Time (ms)", 12);
+  for(const auto &phase: m_phases)
+    text += QString("%1 %2\n").arg(QString::fromStdString(phase.name), -36).arg(phase.milliseconds, 12, 'f', 2);
+
+  text += QString("\n%1 %2 %3\n").arg("Image step", -23).arg("Calls", 12).arg("Time (ms)", 12);
+  for(int i = 0; i < TIMERS; ++i)
+  {
+    const auto timer = static_cast<Timer>(i);
+    text += QString("%1 %2 %3\n").arg(TIMER_NAMES[i], -23).arg(calls(timer), 12).arg(milliseconds(timer), 12, 'f', 2);
+  }
+
+  text += QString("\n%1 %2\n").arg("Counter", -36).arg("Value", 12);
+  for(int i = 0; i < COUNTERS; ++i)
+    text += QString("%1 %2\n").arg(COUNTER_NAMES[i], -36).arg(value(static_cast<Counter>(i)), 12);
+
+  return text;
+}
+
+//---------------------------------------------------------------
+QJsonObject Metrics::toJson() const
+{
+  QJsonArray phases;
+  for(const auto &phase: m_phases)
+  {
+    QJsonObject object;
+    object["name"] = QString::fromStdString(phase.name);
+    object["milliseconds"] = phase.milliseconds;
+    phases.append(object);
+  }
+
+  QJsonObject timers;
+  for(int i = 0; i < TIMERS; ++i)
+  {
+    const auto timer = static_cast<Timer>(i);
+    QJsonObject object;
+    object["calls"] = static_cast<qint64>(calls(timer));
+    object["milliseconds"] = milliseconds(timer);
+    timers[TIMER_NAMES[i]] = object;
+  }
+
+  QJsonObject counters;
+  for(int i = 0; i < COUNTERS; ++i)
+    counters[COUNTER_NAMES[i]] = static_cast<qint64>(value(static_cast<Counter>(i)));
+
+  QJsonObject result;
+  result["phases"] = phases;
+  result["timers"] = timers;
+  result["counters"] = counters;
+
+  return result;
+}
+
+//---------------------------------------------------------------
+Metrics::ScopedTimer::ScopedTimer(Metrics &metrics, Timer timer)
+: m_metrics(metrics)
+, m_timer{timer}
+, m_start{std::chrono::steady_clock::now()}
+, m_stopped{false}
+{
+}
+
+//---------------------------------------------------------------
+Metrics::ScopedTimer::~ScopedTimer()
+{
+  stop();
+}
+
+//---------------------------------------------------------------
+void Metrics::ScopedTimer::stop()
+{
+  if(m_stopped) return;
+
+  m_metrics.addTime(m_timer, std::chrono::steady_clock::now() - m_start);
+  m_stopped = true;
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+TEST_CASE("metrics")
+{
+  Metrics metrics;
+  metrics.add(Metrics::ROWS_SCANNED);
+  metrics.add(Metrics::ROWS_SCANNED, 9);
+  metrics.addTime(Metrics::DECODE, std::chrono::milliseconds(3));
+  metrics.addPhase("scanItems", 1.5);
+
+  {
+    Metrics::ScopedTimer timer(metrics, Metrics::ENCODE);
+    timer.stop();
+    timer.stop();
+  }
+
+  CHECK(metrics.value(Metrics::ROWS_SCANNED) == 10);
+  CHECK(metrics.value(Metrics::ROWS_UPDATED) == 0);
+  CHECK(metrics.calls(Metrics::DECODE) == 1);
+  CHECK(metrics.milliseconds(Metrics::DECODE) == doctest::Approx(3.0));
+  CHECK(metrics.calls(Metrics::ENCODE) == 1);
+  CHECK(metrics.phases().size() == 1);
+
+  metrics.reset();
+  CHECK(metrics.value(Metrics::ROWS_SCANNED) == 0);
+  CHECK(metrics.calls(Metrics::ENCODE) == 0);
+  CHECK(metrics.phases().empty());
+}
+#endif
@@ -0,0 +1,162 @@
+/*
+ File: Metrics.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+// Qt
+#include <QString>
+#include <QJsonObject>
+
+// C++
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/** \struct PhaseTime
+ * \brief Duration of a phase of the process.
+ *
+ */
+struct PhaseTime
+{
+    std::string name;         /** phase name. */
+    double      milliseconds; /** phase duration. */
+};
+
+/** \class Metrics
+ * \brief Accumulates the duration of the phases of the process, the time spent in the steps
+ * of the image computation and some counters. Timers and counters can be updated concurrently
+ * from several threads, phases only from the process thread.
+ *
+ */
+class Metrics
+{
+  public:
+    /** \brief Timed steps of the image computation. */
+    enum Timer: int { FIND_IMAGE = 0, STAT, DECODE, DOWNSCALE, ENCODE, TIMERS };
+
+    /** \brief Counted events. */
+    enum Counter: int { ROWS_SCANNED = 0, ROWS_UPDATED, FILESYSTEM_CALLS, SQLITE_STEPS, ARENA_BYTES, SCALED_DECODES, COUNTERS };
+
+    /** \brief Metrics class constructor.
+     *
+     */
+    Metrics();
+
+    /** \brief Clears all the values.
+     *
+     */
+    void reset();
+
+    /** \brief Adds the duration of a phase.
+     * \param[in] name Phase name.
+     * \param[in] milliseconds Phase duration.
+     *
+     */
+    void addPhase(const std::string &name, double milliseconds);
+
+    /** \brief Adds a call of the given duration to the timer.
+     * \param[in] timer Timer.
+     * \param[in] duration Duration of the call.
+     *
+     */
+    void addTime(Timer timer, std::chrono::nanoseconds duration);
+
+    /** \brief Adds the value to the counter.
+     * \param[in] counter Counter.
+     * \param[in] value Value to add.
+     *
+     */
+    void add(Counter counter, unsigned long value = 1);
+
+    /** \brief Returns the duration of the phases in execution order.
+     *
+     */
+    const std::vector<PhaseTime> &phases() const
+    { return m_phases; }
+
+    /** \brief Returns the accumulated time in milliseconds of the timer.
+     * \param[in] timer Timer.
+     *
+     */
+    double milliseconds(Timer timer) const;
+
+    /** \brief Returns the number of calls of the timer.
+     * \param[in] timer Timer.
+     *
+     */
+    unsigned long calls(Timer timer) const;
+
+    /** \brief Returns the value of the counter.
+     * \param[in] counter Counter.
+     *
+     */
+    unsigned long value(Counter counter) const;
+
+    /** \brief Returns the values as a text table.
+     *
+     */
+    QString summary() const;
+
+    /** \brief Returns the values as a JSON object.
+     *
+     */
+    QJsonObject toJson() const;
+
+    /** \class ScopedTimer
+     * \brief Adds the time from its creation to its destruction, or to the call to stop(),
+     * to a timer.
+     *
+     */
+    class ScopedTimer
+    {
+      public:
+        /** \brief ScopedTimer class constructor.
+         * \param[in] metrics Metrics to update.
+         * \param[in] timer Timer to update.
+         *
+         */
+        ScopedTimer(Metrics &metrics, Timer timer);
+
+        /** \brief ScopedTimer class destructor. Stops the timer if not already stopped.
+         *
+         */
+        ~ScopedTimer();
+
+        /** \brief Adds the elapsed time to the timer. Following calls do nothing.
+         *
+         */
+        void stop();
+
+      private:
+        Metrics                              &m_metrics; /** metrics to update. */
+        const Timer                           m_timer;   /** timer to update. */
+        std::chrono::steady_clock::time_point m_start;   /** start time. */
+        bool                                  m_stopped; /** true if the time was already added. */
+    };
+
+  private:
+    std::vector<PhaseTime>     m_phases;              /** duration of the phases. */
+    std::atomic<long long>     m_nanoseconds[TIMERS]; /** accumulated time of the timers. */
+    std::atomic<unsigned long> m_calls[TIMERS];       /** number of calls of the timers. */
+    std::atomic<unsigned long> m_counters[COUNTERS];  /** counter values. */
+};
+
+#endif // METRICS_H_
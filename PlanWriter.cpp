@@ -0,0 +1,138 @@
+/*
+ File: PlanWriter.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <PlanWriter.h>
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#include <sstream>
+#endif
+
+//---------------------------------------------------------------
+PlanWriter::PlanWriter(const std::filesystem::path &file)
+: m_stream{file, std::ios::binary|std::ios::trunc}
+, m_changes{0}
+, m_rows{0}
+{
+  m_stream << "rowid\tcolumn\told\tnew\n";
+
+  if(!m_stream)
+    m_error = QString("Unable to write plan file '%1'.").arg(QString::fromStdWString(file.wstring()));
+}
+
+//---------------------------------------------------------------
+int PlanWriter::write(sqlite3_stmt *statement)
+{
+  int result;
+  while((result = sqlite3_step(statement)) == SQLITE_ROW)
+  {
+    const auto rowid = sqlite3_column_int64(statement, 0);
+
+    bool changed = false;
+    for(int i = 1; i + 1 < sqlite3_column_count(statement); i += 2)
+    {
+      auto oldValue = sqlite3_column_value(statement, i);
+      auto newValue = sqlite3_column_value(statement, i + 1);
+
+      const auto oldText = escape(oldValue);
+      const auto newText = escape(newValue);
+      if(oldText == newText) continue;
+
+      m_stream << rowid << '\t' << sqlite3_column_name(statement, i) << '\t' << oldText << '\t' << newText << '\n';
+      ++m_changes;
+      changed = true;
+    }
+
+    if(changed) ++m_rows;
+  }
+
+  if(!m_stream && m_error.isEmpty())
+    m_error = QString("Unable to write plan file.");
+
+  return result;
+}
+
+//---------------------------------------------------------------
+std::string PlanWriter::escape(sqlite3_value *value)
+{
+  if(sqlite3_value_type(value) == SQLITE_NULL) return "\\N";
+
+  // Blobs are written as text, the modified blobs are JSON documents.
+  const auto text = reinterpret_cast<const char *>(sqlite3_value_text(value));
+  const auto length = sqlite3_value_bytes(value);
+
+  std::string result;
+  result.reserve(length);
+  for(int i = 0; i < length; ++i)
+  {
+    switch(text[i])
+    {
+      case '\\': result += "\\\\"; break;
+      case '\t': result += "\\t"; break;
+      case '\n': result += "\\n"; break;
+      case '\r': result += "\\r"; break;
+      default:   result += text[i]; break;
+    }
+  }
+
+  return result;
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+TEST_CASE("plan writer")
+{
+  sqlite3 *db = nullptr;
+  REQUIRE(sqlite3_open(":memory:", &db) == SQLITE_OK);
+  REQUIRE(sqlite3_exec(db, "CREATE TABLE t(a, b); INSERT INTO t VALUES('x', NULL), ('y', 2), ('tab\there', 3)",
+                       nullptr, nullptr, nullptr) == SQLITE_OK);
+
+  const auto file = std::filesystem::temp_directory_path() / "PlanWriterTest.tsv";
+
+  {
+    PlanWriter writer(file);
+    REQUIRE(writer.isValid());
+
+    sqlite3_stmt *statement = nullptr;
+    REQUIRE(sqlite3_prepare_v2(db, "SELECT rowid, a, :a, b, :b FROM t", -1, &statement, nullptr) == SQLITE_OK);
+    sqlite3_bind_text(statement, 1, "y", -1, SQLITE_STATIC);
+    sqlite3_bind_int(statement, 2, 2);
+
+    CHECK(writer.write(statement) == SQLITE_DONE);
+    sqlite3_finalize(statement);
+
+    // Rows 1 and 3 change both columns, row 2 doesn't change.
+    CHECK(writer.changes() == 4);
+    CHECK(writer.rows() == 2);
+  }
+
+  std::ifstream stream(file);
+  std::stringstream contents;
+  contents << stream.rdbuf();
+  CHECK(contents.str() == "rowid\tcolumn\told\tnew\n1\ta\tx\ty\n1\tb\t\\N\t2\n3\ta\ttab\\there\ty\n3\tb\t3\t2\n");
+
+  stream.close();
+  std::filesystem::remove(file);
+  sqlite3_close(db);
+}
+#endif
@@ -0,0 +1,94 @@
+/*
+ File: PlanWriter.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLANWRITER_H_
+#define PLANWRITER_H_
+
+// Qt
+#include <QString>
+
+// SQLite3
+#include <sqlite3/sqlite3.h>
+
+// C++
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+/** \class PlanWriter
+ * \brief Writes the changes that an update would make to a tab separated file, one change
+ * per line with the row id, column, old value and new value. Tabs, line breaks and backslashes
+ * in the values are escaped and NULL is written as \N.
+ *
+ */
+class PlanWriter
+{
+  public:
+    /** \brief PlanWriter class constructor. Creates the file and writes the header.
+     * \param[in] file Plan file path.
+     *
+     */
+    explicit PlanWriter(const std::filesystem::path &file);
+
+    /** \brief Returns true if the file could be created and written.
+     *
+     */
+    bool isValid() const
+    { return m_error.isEmpty(); }
+
+    /** \brief Returns the error message or empty if none.
+     *
+     */
+    QString error() const
+    { return m_error; }
+
+    /** \brief Writes the rows returned by the statement and returns the result of the last step.
+     * The statement returns the row id followed by pairs of old and new values of the columns,
+     * the column name is the one of the old value. Only the values that change are written.
+     * \param[in] statement SQLite statement.
+     *
+     */
+    int write(sqlite3_stmt *statement);
+
+    /** \brief Returns the number of written changes.
+     *
+     */
+    unsigned long changes() const
+    { return m_changes; }
+
+    /** \brief Returns the number of rows with at least one change.
+     *
+     */
+    unsigned long rows() const
+    { return m_rows; }
+
+    /** \brief Returns the value escaped to be written in the file.
+     * \param[in] value SQLite value.
+     *
+     */
+    static std::string escape(sqlite3_value *value);
+
+  private:
+    std::ofstream m_stream;  /** plan file stream. */
+    QString       m_error;   /** error message or empty if none. */
+    unsigned long m_changes; /** number of written changes. */
+    unsigned long m_rows;    /** number of rows with changes. */
+};
+
+#endif // PLANWRITER_H_
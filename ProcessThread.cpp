@@ -19,6 +19,18 @@
 
 // Project
 #include <ProcessThread.h>
+#include <BatchWriter.h>
+#include <PlanWriter.h>
+#include <ChangeJournal.h>
+#include <RunState.h>
+#include <JellyfinDefinitions.h>
+#include <ImageUtils.h>
+#include <ThreadPool.h>
+#include <BlurhashCache.h>
+#include <LogBuffer.h>
+#include <ConnectionProfile.h>
+#include <BoundedQueue.h>
+#include <ImageLoader.h>
 
 // Blurhash
 #include <blurhash/blurhash.hpp>
@@ -27,12 +39,13 @@
 #include <filesystem>
 #include <algorithm>
 #include <set>
+#include <unordered_set>
 #include <cassert>
 // For debug
 //#include <iostream>
 
 // Qt
-#include <QImage>
+#include <QFile>
 #include <QFileInfo>
 #include <QDateTime>
 #include <QString>
@@ -41,141 +54,438 @@
 #include <QJsonObject>
 #include <QJsonValue>
 #include <QJsonArray>
-#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
 
-// stb_image
-#define STB_IMAGE_IMPLEMENTATION
-#define STBI_WINDOWS_UTF8
-#include <blurhash/stb_image.h>
+const int BLURHASH_MAXSIZE = 5;
+const size_t IMAGES_PER_THREAD = 4; // Images computed per worker thread in each chunk.
+const size_t OPERATIONS_PER_CHUNK = 256; // Operations per chunk of the generators without images.
+const std::string PATH_INDEX = "JellyfinDBTweaker_PathIndex"; // Index created if the database has none on Path.
+const QString SEPARATOR = " - ";
 
-// Jellyfin database table and types to modify
-const std::string TABLE_NAME = "TypedBaseItems";
-const std::string PLAYLIST_VALUE = "MediaBrowser.Controller.Playlists.Playlist";
-const std::string ALBUM_VALUE    = "MediaBrowser.Controller.Entities.Audio.MusicAlbum";
-const std::string TRACK_VALUE    = "MediaBrowser.Controller.Entities.Audio.Audio";
+// Kinds of operation of the failed items in the run state.
+const std::string PLAYLIST_KIND  = "playlist";
+const std::string TRACKLIST_KIND = "tracklist";
+const std::string TRACK_KIND     = "track";
+const std::string ALBUM_KIND     = "album";
 
-// Empty Playlist data represented as BLOB and string.
-const std::string EMPTY_PLAYLIST_BLOB = "7b224f776e6572557365724964223a223030303030303030303030303030303030303030303030303030303030303030222c22536861726573223a5b5d2c22506c61796c6973744d6564696154797065223a22417564696f222c224973526f6f74223a66616c73652c224c696e6b65644368696c6472656e223a5b5d2c2249734844223a66616c73652c22497353686f7274637574223a66616c73652c225769647468223a302c22486569676874223a302c224578747261496473223a5b5d2c22446174654c6173745361766564223a22303030312d30312d30315430303a30303a30302e303030303030305a222c2252656d6f7465547261696c657273223a5b5d2c22537570706f72747345787465726e616c5472616e73666572223a66616c73657d";
-const std::string EMPTY_PLAYLIST_TEXT = "{\"OwnerUserId\":\"00000000000000000000000000000000\",\"Shares\":[],\"PlaylistMediaType\":\"Audio\",\"IsRoot\":false,\"LinkedChildren\":[],\"IsHD\":false,\"IsShortcut\":false,\"Width\":0,\"Height\":0,\"ExtraIds\":[],\"DateLastSaved\":\"0001-01-01T00:00:00.0000000Z\",\"RemoteTrailers\":[],\"SupportsExternalTransfer\":false}";
+//---------------------------------------------------------------
+static QString batchMessage(const BatchInformation &batch)
+{
+  return QString("Committed batch <b>%1</b>: %2 operations, %3 bytes in %4 ms.").arg(batch.number)
+           .arg(batch.rows).arg(batch.bytes).arg(batch.latency, 0, 'f', 2);
+}
 
-const int BLURHASH_MAXSIZE = 5;
-const QString SEPARATOR = " - ";
+//---------------------------------------------------------------
+static std::string configurationFingerprint(const ProcessConfiguration &config)
+{
+  // Options that change which items are processed or their results.
+  return QString("images=%1;tracklists=%2;artists=%3;numbers=%4;albums=%5;imageName=%6;blurhashSize=%7")
+           .arg(config.processPlaylistImages).arg(config.processPlaylistTracklist).arg(config.processTracksArtists)
+           .arg(config.processTracksNumbers).arg(config.processAlbums).arg(config.imageName).arg(config.blurhashImageSize)
+           .toStdString();
+}
 
-// Global progress values.
-unsigned long operationCount = 0;
-unsigned long totalOperations = 0;
-int currentProgress = 0;
+//---------------------------------------------------------------
+static QString pathText(std::string_view path)
+{
+  return QString::fromStdWString(std::filesystem::path(std::string(path)).wstring());
+}
+
+//---------------------------------------------------------------
+static int bindText(sqlite3_stmt *statement, int index, std::string_view text)
+{
+  // The texts are in the arena until the end of the run. Empty views can have no data and
+  // would be bound as NULL.
+  return sqlite3_bind_text(statement, index, text.empty() ? "" : text.data(), text.size(), SQLITE_STATIC);
+}
 
 //---------------------------------------------------------------
-ProcessThread::ProcessThread(sqlite3 *db, const ProcessConfiguration config, QObject *parent)
+static QString pragmasText(const std::vector<PragmaValue> &pragmas)
+{
+  QStringList values;
+  for(const auto &pragma: pragmas)
+    values << QString("%1=<b>%2</b>").arg(QString::fromStdString(pragma.name)).arg(QString::fromStdString(pragma.value));
+
+  return values.join(", ");
+}
+
+//---------------------------------------------------------------
+ProcessThread::ProcessThread(sqlite3 *db, const ProcessConfiguration config, LogBuffer &log, QObject *parent)
 : QThread(parent)
 , m_sql3Handle{db}
+, m_log(log)
 , m_config{config}
 , m_abort{false}
 , m_dbModified{false}
+, m_pathIndexCreated{false}
+, m_operations{0}
+, m_totalOperations{0}
 {
   assert(m_sql3Handle);
 }
 
+//---------------------------------------------------------------
+ProcessThread::~ProcessThread()
+{
+}
+
 //---------------------------------------------------------------
 void ProcessThread::run()
+{
+  m_metrics.reset();
+
+  // The database has been copied before the run, durability can be traded for speed.
+  ConnectionProfile profile(m_sql3Handle);
+  if(m_config.bulkProfile)
+  {
+    if(profile.apply(ConnectionProfile::bulkMaintenance()))
+    {
+      log(QString("Bulk maintenance profile: %1.").arg(pragmasText(profile.active())));
+    }
+    else
+    {
+      log(QString("<span style=\" color:#ff0000;\">Unable to apply bulk maintenance profile, using the current settings. %1</span>").arg(profile.error()));
+    }
+  }
+
+  process();
+
+  if(m_config.bulkProfile)
+  {
+    const auto previous = profile.previous();
+    if(profile.restore())
+    {
+      if(!previous.empty()) log(QString("Restored connection settings: %1.").arg(pragmasText(previous)));
+    }
+    else
+    {
+      log(QString("<span style=\" color:#ff0000;\">Unable to restore connection settings. %1</span>").arg(profile.error()));
+    }
+  }
+
+  reportMetrics();
+}
+
+//---------------------------------------------------------------
+void ProcessThread::process()
 {
   try
   {
     if(m_sql3Handle)
     {
-      emit progress(currentProgress);
+      m_operations = 0;
+      m_totalOperations = 0;
+      m_folders.clear();
+      m_arena.clear();
 
-      // Count the number of operations for the progress bar.
-      //
-      countOperations();
+      QElapsedTimer phaseTimer;
+      phaseTimer.start();
 
-      if(totalOperations == 0)
-      {
-        emit message("No update operations to perform.");
-        return;
-      }
+      openRunState();
 
-      emit message("Generating UPDATE data...");
-
-      // Generate needed data for updates.
+      // Read the items to process and count the number of operations for the progress bar.
       //
-      const auto playlistOperations = generatePlaylistImageOperations();
+      scanItems();
+      phaseFinished("scanItems", phaseTimer);
 
-      if(m_abort)
+      if(!m_error.isEmpty()) return;
+
+      if(m_totalOperations == 0)
       {
-        m_error = "Aborted operation.";
+        log("No update operations to perform.");
+        saveRunState();
         return;
       }
 
-      const auto playlistTracksOperations = generatePlaylistTracksOperations();
+      log("Generating UPDATE data...");
 
-      if(m_abort)
+      if(!m_config.cacheFile.isEmpty())
       {
-        m_error = "Aborted operation.";
-        return;
+        m_cache = std::make_unique<BlurhashCache>(m_config.cacheFile.toStdWString());
+        if(!m_cache->isValid())
+        {
+          log(QString("<span style=\" color:#ff0000;\">%1</span>").arg(m_cache->error()));
+          m_cache = nullptr;
+        }
       }
 
-      const auto trackOperations = generateTracksNumberOperationData();
-
-      if(m_abort)
+      // Operations are applied while the rest are generated. Operations are grouped in transactions,
+      // the last one is committed even if the process is aborted to keep the operations already
+      // applied. In a dry run the current and new values are written to the plan file instead.
+      //
+      if(m_config.dryRun)
       {
-        m_error = "Aborted operation.";
-        return;
+        m_plan = std::make_unique<PlanWriter>(m_config.planFile.toStdWString());
+        if(!m_plan->isValid())
+        {
+          m_error = m_plan->error();
+          m_plan = nullptr;
+          return;
+        }
+
+        log("Dry run, writing planned changes while generating data. Please wait...");
       }
+      else
+      {
+        // The journal must record the changes from the first update.
+        if(!m_config.journalFile.isEmpty())
+        {
+          m_journal = std::make_unique<ChangeJournal>(m_sql3Handle, TABLE_NAME);
+          if(!m_journal->isValid())
+          {
+            m_error = m_journal->error();
+            m_journal = nullptr;
+            return;
+          }
+        }
 
-      const auto albumOperations = generateAlbumsOperationsData(playlistOperations);
+        log("Updating database while generating data. Please wait...");
 
-      if(m_abort)
+        m_dbModified = true;
+        m_writer = std::make_unique<BatchWriter>(m_sql3Handle, m_config.batchRows, m_config.batchBytes);
+
+        // The changes of each transaction are in the journal before they are committed.
+        if(m_journal) m_writer->setBeforeCommit([this](QString &error) { return saveJournal(error); });
+      }
+
+      phaseTimer.restart();
+      if(!m_plan)
       {
-        m_error = "Aborted operation.";
-        return;
+        // An aborted or crashed run can leave the index in the database.
+        dropStalePathIndex();
+        if(m_config.pathIndex && m_config.processPlaylistImages && !m_items.playlists.empty()) createPathIndex();
       }
+      phaseFinished("createPathIndex", phaseTimer);
 
-      emit message("Finished generating data, updating database. Please wait...");
+      m_pool = std::make_unique<ThreadPool>(m_config.threads);
+      log(QString("Computing images using <b>%1</b> threads.").arg(m_pool->size()));
 
-      // Apply operations.
+      // The generators run in the producer thread and this thread applies their operations as they
+      // are ready, the queue blocks the generators when the writer falls behind so the operations in
+      // memory are limited by the queue depth.
       //
-      m_dbModified = true;
-      updatePlaylistImages(playlistOperations);
+      OperationsQueue queue(m_config.queueDepth);
+      std::vector<PhaseTime> generatorPhases;
+      QString generatorError;
+      std::thread producer([this, &queue, &generatorPhases, &generatorError]()
+      {
+        try
+        {
+          generatorPhases = generateOperations(queue);
+        }
+        catch(const std::exception &e)
+        {
+          generatorError = QString("Exception: %1").arg(QString::fromLatin1(e.what()));
+          queue.close();
+        }
+        catch(...)
+        {
+          generatorError = QString("Unknown exception");
+          queue.close();
+        }
+      });
 
-      if(m_abort)
+      try
       {
-        m_error = "Aborted operation.";
-        return;
+        applyOperations(queue);
+      }
+      catch(...)
+      {
+        queue.close();
+        producer.join();
+        throw;
       }
+      producer.join();
+      phaseFinished("pipeline", phaseTimer);
 
-      updateAlbumOperations(albumOperations);
+      for(const auto &phase: generatorPhases)
+        m_metrics.addPhase(phase.name, phase.milliseconds);
 
-      if(m_abort)
+      if(!generatorError.isEmpty() && m_error.isEmpty()) m_error = generatorError;
+
+      m_pool = nullptr;
+
+      log(QString("Operations queue of <b>%1</b> chunks, maximum <b>%2</b> queued, generators waited %3 times for the writer and "
+                  "the writer %4 times for the generators.").arg(queue.capacity()).arg(queue.maximum())
+                   .arg(queue.fullWaits()).arg(queue.emptyWaits()));
+
+      log(QString("Listed <b>%1</b> folders.").arg(m_directories.size()));
+
+      const auto arena = m_arena.statistics();
+      m_metrics.add(Metrics::ARENA_BYTES, arena.reserved);
+      log(QString("Operations texts: <b>%1</b> strings, %2 KB used of %3 KB in %4 blocks, %5 repeated folders and names shared.")
+                   .arg(arena.strings).arg(arena.bytes / 1024.0, 0, 'f', 1).arg(arena.reserved / 1024.0, 0, 'f', 1)
+                   .arg(arena.blocks).arg(arena.shared));
+
+      if(m_cache)
       {
-        m_error = "Aborted operation.";
-        return;
+        log(QString("Blurhash cache: <b>%1</b> hits, <b>%2</b> misses.").arg(m_cache->hits()).arg(m_cache->misses()));
+        m_cache = nullptr;
       }
 
-      updateTrackNumbers(trackOperations);
+      finishWrites();
+      phaseFinished("finishWrites", phaseTimer);
+
+      writeJournal();
+      dropPathIndex();
+
+      if(m_plan)
+      {
+        log(QString("Dry run: <b>%1</b> changes in <b>%2</b> rows written to <b>'%3'</b>.").arg(m_plan->changes())
+                     .arg(m_plan->rows()).arg(m_config.planFile));
+        m_plan = nullptr;
+      }
 
       if(m_abort)
       {
-        m_error = "Aborted operation.";
+        if(m_error.isEmpty()) m_error = "Aborted operation.";
         return;
       }
 
-      updatePlaylistTracks(playlistTracksOperations);
+      saveRunState();
 
-      emit message("<b>Finished!</b>");
-    }
+      log("<b>Finished!</b>");
 
-    emit progress(100);
+      m_operations.store(m_totalOperations);
+    }
   }
   catch(const std::exception &e)
   {
     m_error = QString("Exception: %1").arg(QString::fromLatin1(e.what()));
+    finishWrites();
+    m_plan = nullptr;
+    writeJournal();
+    dropPathIndex();
   }
   catch(...)
   {
     m_error = QString("Unknown exception");
+    finishWrites();
+    m_plan = nullptr;
+    writeJournal();
+    dropPathIndex();
+  }
+}
+
+//---------------------------------------------------------------
+void ProcessThread::openRunState()
+{
+  m_state = nullptr;
+  m_watermark.clear();
+
+  if(m_config.stateFile.isEmpty()) return;
+
+  auto state = std::make_unique<RunState>(m_config.stateFile.toStdWString());
+  if(!state->isValid())
+  {
+    log(QString("<span style=\" color:#ff0000;\">%1 Processing all the items.</span>").arg(state->error()));
+    return;
+  }
+
+  // Items created or modified after the watermark are always processed.
+  const auto sql = std::string("SELECT MAX(COALESCE(MAX(") + MODIFIED_COLUMN + "), ''), COALESCE(MAX(" + CREATED_COLUMN + "), '')) FROM " + TABLE_NAME;
+
+  sqlite3_stmt *statement = nullptr;
+  auto result = sqlite3_prepare_v2(m_sql3Handle, sql.c_str(), -1, &statement, nullptr);
+  if(result == SQLITE_OK) result = step(statement);
+  if(result == SQLITE_ROW && sqlite3_column_text(statement, 0))
+    m_watermark = reinterpret_cast<const char *>(sqlite3_column_text(statement, 0));
+  sqlite3_finalize(statement);
+
+  if(result != SQLITE_ROW)
+  {
+    log(QString("<span style=\" color:#ff0000;\">Unable to read the dates of the items, processing all the items. SQLite3 error: %1</span>")
+                 .arg(QString::fromLatin1(sqlite3_errmsg(m_sql3Handle))));
+    return;
+  }
+
+  if(state->lastRun().empty())
+  {
+    log("No previous run state, processing all the items.");
+  }
+  else
+  {
+    if(state->configuration() != configurationFingerprint(m_config))
+    {
+      log("Configuration changed since the last run, processing all the items.");
+      state->clear();
+    }
+    else
+    {
+      log(QString("Incremental run, last run on <b>%1</b>, items modified after <b>%2</b> are processed again.")
+                   .arg(QString::fromStdString(state->lastRun())).arg(QString::fromStdString(state->watermark())));
+    }
+  }
+
+  m_state = std::move(state);
+}
+
+//---------------------------------------------------------------
+void ProcessThread::saveRunState()
+{
+  // Only finished runs update the state, a dry run doesn't modify the items.
+  if(!m_state || m_config.dryRun || m_abort || !m_error.isEmpty()) return;
+
+  const auto now = QDateTime::currentDateTimeUtc().toString("yyyy-MM-ddThh:mm:ssZ").toStdString();
+  if(!m_state->save(now, m_watermark, configurationFingerprint(m_config)))
+  {
+    log(QString("<span style=\" color:#ff0000;\">%1</span>").arg(m_state->error()));
+    return;
+  }
+
+  log(QString("Run state saved to <b>'%1'</b>, <b>%2</b> items failed.").arg(m_config.stateFile).arg(m_state->failures()));
+}
+
+//---------------------------------------------------------------
+bool ProcessThread::isKnownFailure(const std::string &kind, const ItemData &item)
+{
+  if(!m_state || item.changed) return false;
+
+  m_metrics.add(Metrics::FILESYSTEM_CALLS);
+  return m_state->isKnownFailure(kind, item.path);
+}
+
+//---------------------------------------------------------------
+void ProcessThread::addFailure(const std::string &kind, const std::string &path, const std::filesystem::path &folder, const std::string &reason)
+{
+  if(!m_state) return;
+
+  m_metrics.add(Metrics::FILESYSTEM_CALLS);
+  m_state->addFailure(kind, path, folder, reason);
+}
+
+//---------------------------------------------------------------
+void ProcessThread::phaseFinished(const std::string &name, QElapsedTimer &timer)
+{
+  m_metrics.addPhase(name, timer.nsecsElapsed() / 1000000.0);
+  timer.restart();
+}
+
+//---------------------------------------------------------------
+void ProcessThread::reportMetrics()
+{
+  m_metrics.add(Metrics::FILESYSTEM_CALLS, m_directories.filesystemCalls());
+
+  log(QString("<pre>%1</pre>").arg(m_metrics.summary().toHtmlEscaped()));
+
+  if(m_config.metricsFile.isEmpty()) return;
+
+  QFile file(m_config.metricsFile);
+  if(!file.open(QIODevice::WriteOnly|QIODevice::Truncate) || file.write(QJsonDocument(m_metrics.toJson()).toJson()) < 0)
+  {
+    log(QString("<span style=\" color:#ff0000;\">Unable to write metrics file <b>'%1'</b>: %2</span>")
+                 .arg(m_config.metricsFile).arg(file.errorString()));
+    return;
   }
+
+  log(QString("Metrics written to <b>'%1'</b>.").arg(m_config.metricsFile));
+}
+
+//---------------------------------------------------------------
+void ProcessThread::log(const QString &message)
+{
+  m_log.push(message);
 }
 
 //---------------------------------------------------------------
@@ -190,210 +500,537 @@ bool ProcessThread::checkSQLiteError(int code, int expectedCode, int line)
 };
 
 //---------------------------------------------------------------
-unsigned long ProcessThread::countSQLiteOperation(const std::string &where_sql)
+int ProcessThread::step(sqlite3_stmt *statement)
 {
-  auto count_callback = [](void *data, int, char **rowData, char **)
+  m_metrics.add(Metrics::SQLITE_STEPS);
+  return sqlite3_step(statement);
+}
+
+//---------------------------------------------------------------
+std::vector<ColumnAssignment> ProcessThread::metadataColumns() const
+{
+  std::vector<ColumnAssignment> columns;
+  if(m_config.processTracksArtists)
   {
-    auto counter = reinterpret_cast<unsigned long *>(data);
-    *counter = atol(rowData[0]);
-    return 0;
-  };
+    columns.push_back(ColumnAssignment{"Artists", ":artist"});
+    columns.push_back(ColumnAssignment{"AlbumArtists", ":artist"});
+    columns.push_back(ColumnAssignment{"Album", ":album"});
+  }
 
-  unsigned long count = 0;
+  if(m_config.processPlaylistImages)
+    columns.push_back(ColumnAssignment{"Images", ":image"});
 
-  const auto sql = std::string("SELECT COUNT(*) FROM ") + TABLE_NAME + where_sql;
-  const auto result = sqlite3_exec(m_sql3Handle, sql.c_str(), count_callback, &count, nullptr);
-  if (result != SQLITE_OK)
+  return columns;
+}
+
+//---------------------------------------------------------------
+std::string ProcessThread::updateSql(const std::vector<ColumnAssignment> &columns, const std::string &condition) const
+{
+  std::string values;
+  for(const auto &assignment: columns)
   {
-    emit message(QString("Unable to perform count operation. Where statement is: %1. SQLite3 error: %2.")
-        .arg(QString::fromStdString(where_sql)).arg(QString::fromLatin1(sqlite3_errstr(result))));
-    return 0;
+    if(m_config.dryRun)
+      values += (values.empty() ? "" : ", ") + assignment.column + ", " + assignment.parameter;
+    else
+      values += (values.empty() ? "" : ", ") + assignment.column + "=" + assignment.parameter;
   }
 
-  return count;
+  if(m_config.dryRun)
+    return std::string("SELECT rowid, ") + values + " FROM " + TABLE_NAME + " WHERE " + condition;
+
+  return std::string("UPDATE ") + TABLE_NAME + " SET " + values + " WHERE " + condition;
 }
 
 //---------------------------------------------------------------
-std::vector<PlaylistImageOperationData> ProcessThread::generatePlaylistImageOperations()
+int ProcessThread::applyUpdate(sqlite3_stmt *statement)
 {
-  std::vector<PlaylistImageOperationData> operations;
+  if(!m_plan)
+  {
+    // A failed step can leave the changes count of a previous statement.
+    const auto result = step(statement);
+    if(result == SQLITE_DONE) m_metrics.add(Metrics::ROWS_UPDATED, sqlite3_changes(m_sql3Handle));
 
-  if(m_config.processPlaylistImages)
+    return result;
+  }
+
+  const auto rows = m_plan->rows();
+  const auto result = m_plan->write(statement);
+  m_metrics.add(Metrics::ROWS_UPDATED, m_plan->rows() - rows);
+
+  if(!m_plan->isValid())
   {
-    sqlite3_stmt *statement;
-    auto sql = std::string("SELECT * FROM ") + TABLE_NAME + " where type='" + PLAYLIST_VALUE + "' AND (Images IS NULL OR Album IS NULL OR Artists IS NULL)";
-    auto result = sqlite3_prepare_v2(m_sql3Handle, sql.c_str(), -1, &statement, nullptr);
-    if(!checkSQLiteError(result,  SQLITE_OK, __LINE__))
+    m_error = m_plan->error();
+    abort();
+  }
+
+  return result;
+}
+
+//---------------------------------------------------------------
+void ProcessThread::createPathIndex()
+{
+  // Jellyfin databases usually have an index on Path already.
+  const auto checkSql = std::string("SELECT l.name FROM pragma_index_list('") + TABLE_NAME + "') l, pragma_index_xinfo(l.name) i "
+                        "WHERE i.seqno=0 AND i.name='" + PATH_COLUMN + "' AND i.coll='BINARY' AND l.partial=0";
+
+  sqlite3_stmt *statement;
+  auto result = sqlite3_prepare_v2(m_sql3Handle, checkSql.c_str(), -1, &statement, nullptr);
+  if(result != SQLITE_OK) return;
+
+  result = step(statement);
+  if(result == SQLITE_ROW)
+  {
+    log(QString("Using index <b>'%1'</b> to update the tracks of the playlists.")
+                 .arg(QString::fromUtf8(reinterpret_cast<const char *>(sqlite3_column_text(statement, 0)))));
+  }
+  sqlite3_finalize(statement);
+
+  if(result != SQLITE_DONE) return;
+
+  QElapsedTimer timer;
+  timer.start();
+
+  const auto sql = std::string("CREATE INDEX IF NOT EXISTS ") + PATH_INDEX + " ON " + TABLE_NAME + "(" + PATH_COLUMN + ")";
+  result = sqlite3_exec(m_sql3Handle, sql.c_str(), nullptr, nullptr, nullptr);
+  if(result != SQLITE_OK)
+  {
+    log(QString("<span style=\" color:#ff0000;\">Unable to create index on paths. SQLite3 error: %1</span>")
+                 .arg(QString::fromLatin1(sqlite3_errmsg(m_sql3Handle))));
+    return;
+  }
+
+  m_pathIndexCreated = true;
+  log(QString("Created temporary index on paths in %1 ms.").arg(timer.nsecsElapsed() / 1000000.0, 0, 'f', 2));
+}
+
+//---------------------------------------------------------------
+void ProcessThread::dropStalePathIndex()
+{
+  const auto checkSql = std::string("SELECT name FROM sqlite_master WHERE type='index' AND name='") + PATH_INDEX + "'";
+
+  sqlite3_stmt *statement;
+  auto result = sqlite3_prepare_v2(m_sql3Handle, checkSql.c_str(), -1, &statement, nullptr);
+  if(result != SQLITE_OK) return;
+
+  result = step(statement);
+  sqlite3_finalize(statement);
+
+  if(result != SQLITE_ROW) return;
+
+  const auto sql = std::string("DROP INDEX IF EXISTS ") + PATH_INDEX;
+  result = sqlite3_exec(m_sql3Handle, sql.c_str(), nullptr, nullptr, nullptr);
+  if(result != SQLITE_OK)
+  {
+    log(QString("<span style=\" color:#ff0000;\">Unable to remove index on paths of a previous run. SQLite3 error: %1</span>")
+                 .arg(QString::fromLatin1(sqlite3_errmsg(m_sql3Handle))));
+    return;
+  }
+
+  log("Removed temporary index on paths left by a previous run.");
+}
+
+//---------------------------------------------------------------
+void ProcessThread::dropPathIndex()
+{
+  if(!m_pathIndexCreated) return;
+
+  const auto sql = std::string("DROP INDEX IF EXISTS ") + PATH_INDEX;
+  const auto result = sqlite3_exec(m_sql3Handle, sql.c_str(), nullptr, nullptr, nullptr);
+  if(result != SQLITE_OK)
+  {
+    log(QString("<span style=\" color:#ff0000;\">Unable to remove index on paths. SQLite3 error: %1</span>")
+                 .arg(QString::fromLatin1(sqlite3_errmsg(m_sql3Handle))));
+    return;
+  }
+
+  m_pathIndexCreated = false;
+}
+
+//---------------------------------------------------------------
+bool ProcessThread::beginWrite()
+{
+  // Dry runs don't write.
+  if(!m_writer) return true;
+
+  if(!m_writer->begin())
+  {
+    m_error = m_writer->error();
+    abort();
+    return false;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------
+void ProcessThread::endWrite(unsigned long bytes)
+{
+  if(!m_writer) return;
+
+  if(m_writer->rowWritten(bytes))
+  {
+    log(batchMessage(m_writer->lastBatch()));
+  }
+  else
+  {
+    if(!m_writer->error().isEmpty())
     {
-      m_error = QString("Unable to make SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
-      sqlite3_finalize(statement);
+      m_error = m_writer->error();
       abort();
-      return operations;
     }
+  }
+}
+
+//---------------------------------------------------------------
+void ProcessThread::finishWrites()
+{
+  if(!m_writer) return;
+
+  const auto previous = m_writer->batches();
+  if(!m_writer->commit())
+  {
+    m_error = m_writer->error();
+  }
+  else
+  {
+    if(m_writer->batches() != previous)
+    {
+      log(batchMessage(m_writer->lastBatch()));
+    }
+  }
+
+  if(m_writer->batches() > 0)
+  {
+    log(QString("Applied updates in <b>%1</b> transactions, commit time total %2 ms, average %3 ms, maximum %4 ms.")
+                 .arg(m_writer->batches()).arg(m_writer->totalLatency(), 0, 'f', 2)
+                 .arg(m_writer->totalLatency()/m_writer->batches(), 0, 'f', 2).arg(m_writer->maximumLatency(), 0, 'f', 2));
+  }
+
+  m_writer = nullptr;
+}
+
+//---------------------------------------------------------------
+bool ProcessThread::saveJournal(QString &error)
+{
+  if(!m_journal) return true;
+
+  if(!m_journal->append(m_config.journalFile.toStdWString()))
+  {
+    error = m_journal->error();
+    log(QString("<span style=\" color:#ff0000;\">%1</span>").arg(error));
+    return false;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------
+void ProcessThread::writeJournal()
+{
+  if(!m_journal) return;
+
+  // The changes have been appended before each commit, the file is created if there were none.
+  QString error;
+  if(saveJournal(error))
+  {
+    log(QString("Changes journal of %1 bytes written to <b>'%2'</b>.").arg(m_journal->bytes()).arg(m_config.journalFile));
+  }
+  else
+  {
+    if(m_error.isEmpty()) m_error = error;
+  }
+
+  m_journal = nullptr;
+}
+
+//---------------------------------------------------------------
+std::vector<PhaseTime> ProcessThread::generateOperations(OperationsQueue &queue)
+{
+  std::vector<PhaseTime> phases;
+
+  QElapsedTimer timer;
+  timer.start();
+  auto finished = [&phases, &timer](const std::string &name)
+  {
+    phases.push_back(PhaseTime{name, timer.nsecsElapsed() / 1000000.0});
+    timer.restart();
+  };
+
+  // Each generator stops if the writer has closed the queue.
+  bool accepted = generatePlaylistImageOperations(queue);
+  finished("generatePlaylistImageOperations");
+
+  if(accepted)
+  {
+    accepted = generatePlaylistTracksOperations(queue);
+    finished("generatePlaylistTracksOperations");
+  }
+
+  if(accepted)
+  {
+    accepted = generateTracksNumberOperationData(queue);
+    finished("generateTracksNumberOperationData");
+  }
+
+  if(accepted)
+  {
+    generateAlbumsOperationsData(queue);
+    finished("generateAlbumsOperationsData");
+  }
+
+  queue.close();
+
+  return phases;
+}
+
+//---------------------------------------------------------------
+void ProcessThread::applyOperations(OperationsQueue &queue)
+{
+  double playlistsTime = 0, tracklistsTime = 0, tracksTime = 0, albumsTime = 0;
+  unsigned long playlistsUpdated = 0;
+
+  QElapsedTimer timer;
+  auto elapsed = [&timer]()
+  {
+    const double milliseconds = timer.nsecsElapsed() / 1000000.0;
+    timer.restart();
+    return milliseconds;
+  };
+
+  OperationsChunk chunk;
+  while(!m_abort && queue.pop(chunk))
+  {
+    timer.start();
+
+    if(!chunk.playlists.empty()) playlistsUpdated += updatePlaylistImages(chunk.playlists);
+    playlistsTime += elapsed();
+
+    if(!m_abort && !chunk.tracklists.empty()) updatePlaylistTracks(chunk.tracklists);
+    tracklistsTime += elapsed();
+
+    if(!m_abort && !chunk.tracks.empty()) updateTrackNumbers(chunk.tracks);
+    tracksTime += elapsed();
+
+    if(!m_abort && !chunk.albums.empty()) updateAlbumOperations(chunk.albums);
+    albumsTime += elapsed();
+
+    chunk = OperationsChunk();
+  }
+
+  // The chunks left in the queue of an aborted process are discarded.
+  queue.close();
+
+  if(playlistsUpdated > 0)
+  {
+    log(QString("Updated metadata of <b>%1</b> playlist folders in %2 ms, average %3 ms.").arg(playlistsUpdated)
+                 .arg(playlistsTime, 0, 'f', 2).arg(playlistsTime / playlistsUpdated, 0, 'f', 2));
+  }
+
+  m_metrics.addPhase("updatePlaylistImages", playlistsTime);
+  m_metrics.addPhase("updatePlaylistTracks", tracklistsTime);
+  m_metrics.addPhase("updateTrackNumbers", tracksTime);
+  m_metrics.addPhase("updateAlbumOperations", albumsTime);
+}
+
+//---------------------------------------------------------------
+bool ProcessThread::generatePlaylistImageOperations(OperationsQueue &queue)
+{
+  if(m_config.processPlaylistImages)
+  {
+    const auto &items = m_items.playlists;
+    const size_t chunkSize = m_pool->size() * IMAGES_PER_THREAD;
 
-    while ((result = sqlite3_step(statement)) == SQLITE_ROW)
+    for(size_t first = 0; first < items.size(); first += chunkSize)
     {
-      if(m_abort)
+      if(m_abort) return false;
+
+      // The image of each folder is computed once, by the first of its playlists.
+      const auto last = std::min(items.size(), first + chunkSize);
+      std::vector<ArenaPath> paths(last - first);
+      std::vector<bool> compute(last - first, false);
+      std::unordered_set<std::string_view> pending;
+      for(size_t i = first; i < last; ++i)
       {
-        m_error = "Aborted operation.";
-        sqlite3_finalize(statement);
-        return operations;
+        paths[i - first] = m_arena.path(items[i].path);
+        const auto folder = paths[i - first].parent();
+        compute[i - first] = !m_folders.contains(folder) && pending.insert(folder).second;
       }
 
-      const auto pathValue = reinterpret_cast<const char *>(sqlite3_column_text(statement, 4));
+      // Images are computed in the worker threads and processed here in the playlists order.
+      std::vector<FolderImage> images(last - first);
+      m_pool->run(images.size(), [&](size_t i)
+      {
+        const std::filesystem::path playlistPath(items[first + i].path);
+        m_metrics.add(Metrics::FILESYSTEM_CALLS);
+
+        // Runs in a worker thread, a path that can't be checked is reported as missing.
+        std::error_code errorCode;
+        if(m_abort || !std::filesystem::exists(playlistPath, errorCode)) return;
 
-      const std::filesystem::path playlistPath(pathValue);
-      if(!std::filesystem::exists(playlistPath))
+        if(compute[i]) images[i] = folderImage(playlistPath.parent_path());
+        else images[i].exists = true;
+      });
+
+      OperationsChunk chunk;
+      for(size_t i = first; i < last && !m_abort; ++i)
       {
-        emit message(QString("<span style=\" color:#ff0000;\">Playlist path <b>'%1'</b> doesn't exist!</span>").arg(QString::fromStdWString(playlistPath.wstring())));
-        continue;
-      }
+        const std::filesystem::path playlistPath(items[i].path);
+        const auto &image = images[i - first];
+        if(!image.exists)
+        {
+          log(QString("<span style=\" color:#ff0000;\">Playlist path <b>'%1'</b> doesn't exist!</span>").arg(QString::fromStdWString(playlistPath.wstring())));
+          addFailure(PLAYLIST_KIND, items[i].path, playlistPath.parent_path(), "Playlist path doesn't exist");
+          continue;
+        }
+
+        log(QString("Generate metadata information of playlist <b>'%1'</b>.").arg(QString::fromStdWString(playlistPath.filename().wstring())));
 
-      emit message(QString("Generate metadata information of playlist <b>'%1'</b>.").arg(QString::fromStdWString(playlistPath.filename().wstring())));
+        const auto &path = paths[i - first];
+        std::string_view imageData;
+        const auto known = m_folders.find(path.parent());
+        if(known != m_folders.cend())
+        {
+          imageData = known->second.imageData;
+        }
+        else
+        {
+          // The playlist that should have computed the image of the folder doesn't exist.
+          FolderImage fallback;
+          if(!compute[i - first]) fallback = folderImage(playlistPath.parent_path());
 
-      std::string album, artist, entryData;
+          const auto &folderData = compute[i - first] ? image : fallback;
+          if(!folderData.error.isEmpty()) log(folderData.error);
+          imageData = m_arena.store(folderData.data);
+        }
 
-      entryData = albumBlurhash(playlistPath.parent_path());
+        if(imageData.empty()) addFailure(PLAYLIST_KIND, items[i].path, playlistPath.parent_path(), "No image");
 
-      auto metadata = artistAndAlbumMetadata(playlistPath.parent_path().stem().wstring());
-      if(metadata == std::pair<std::string, std::string>())
-      {
-        metadata = artistAndAlbumMetadata(playlistPath.stem().wstring());
-      }
+        auto metadata = artistAndAlbumMetadata(playlistPath.parent_path().stem().wstring());
+        if(metadata == std::pair<std::string, std::string>())
+        {
+          metadata = artistAndAlbumMetadata(playlistPath.stem().wstring());
+        }
 
-      artist = metadata.first;
-      album = metadata.second;
+        if(metadata.first.empty() || metadata.second.empty())
+        {
+          metadata.first = "Unknown";
+          metadata.second = playlistPath.stem().string();
+        }
 
-      if(artist.empty() || album.empty())
-      {
-        artist = "Unknown";
-        album = playlistPath.stem().string();
-      }
+        const PlaylistImageOperationData operation{path, imageData, m_arena.intern(metadata.first), m_arena.intern(metadata.second)};
+        chunk.playlists.push_back(operation);
 
-      operations.emplace_back(playlistPath, entryData, artist, album);
+        // The data of the first playlist of the folder is reused by the albums in the same folder.
+        m_folders.emplace(path.parent(), FolderMetadata{operation.imageData, operation.artist, operation.album});
 
-      checkProgress(++operationCount);
-    }
+        ++m_operations;
+      }
 
-    if (result != SQLITE_DONE)
-    {
-      m_error = QString("Unable to finish step SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
-    }
-    result = sqlite3_finalize(statement);
-    if(result != SQLITE_OK)
-    {
-      m_error = QString("Unable to finalize SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
+      if(!chunk.playlists.empty() && !queue.push(std::move(chunk))) return false;
     }
   }
 
-  return operations;
+  return true;
 }
 
 //---------------------------------------------------------------
-std::vector<PlaylistImageOperationData> ProcessThread::generateAlbumsOperationsData(const std::vector<PlaylistImageOperationData> &playlistOps)
+bool ProcessThread::generateAlbumsOperationsData(OperationsQueue &queue)
 {
-  std::vector<PlaylistImageOperationData> operations;
-
   if(m_config.processAlbums)
   {
-    sqlite3_stmt * statement;
-    const auto sql = std::string("SELECT * FROM ") + TABLE_NAME + " WHERE type='" + ALBUM_VALUE + "' AND (Images IS NULL OR Album IS NULL OR Artists IS NULL)";
-    auto result = sqlite3_prepare_v2(m_sql3Handle, sql.c_str(), -1, &statement, nullptr);
-    if(!checkSQLiteError(result, SQLITE_OK, __LINE__))
-    {
-      m_error = QString("Unable to make SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
-      sqlite3_finalize(statement);
-      return operations;
-    }
+    const auto &items = m_items.albums;
+    const size_t chunkSize = m_pool->size() * IMAGES_PER_THREAD;
 
-    while ((result = sqlite3_step(statement)) == SQLITE_ROW)
+    for(size_t first = 0; first < items.size(); first += chunkSize)
     {
-      if(m_abort)
+      if(m_abort) return false;
+
+      // Reuse the data of the folders already processed, the rest are computed once per folder.
+      const auto last = std::min(items.size(), first + chunkSize);
+      std::vector<bool> compute(last - first, false);
+      std::unordered_set<std::string_view> pending;
+      for(size_t i = first; i < last; ++i)
       {
-        m_error = "Aborted operation.";
-        sqlite3_finalize(statement);
-        return operations;
+        const std::string_view folder(items[i].path);
+        compute[i - first] = !m_folders.contains(folder) && pending.insert(folder).second;
       }
 
-      auto pathValue = reinterpret_cast<const char *>(sqlite3_column_text(statement, 4));
+      // The rest of the images are computed in the worker threads.
+      std::vector<FolderImage> images(last - first);
+      m_pool->run(images.size(), [&](size_t i)
+      {
+        if(!m_abort && compute[i])
+          images[i] = folderImage(std::filesystem::path(items[first + i].path));
+      });
 
-      const std::filesystem::path albumPath(pathValue);
+      OperationsChunk chunk;
+      for(size_t i = first; i < last && !m_abort; ++i)
+      {
+        const std::filesystem::path albumPath(items[i].path);
 
-      emit message(QString("Generate metadata information of album <b>'%1'</b>.").arg(QString::fromStdWString(albumPath.filename().wstring())));
+        log(QString("Generate metadata information of album <b>'%1'</b>.").arg(QString::fromStdWString(albumPath.filename().wstring())));
 
-      std::string entryData, artist, album;
+        std::string_view entryData, artist, album;
 
-      auto sameAs = [&albumPath](const PlaylistImageOperationData &data){ return data.path.parent_path() == albumPath; };
-      auto it = std::find_if(playlistOps.cbegin(), playlistOps.cend(), sameAs);
-      if(it != playlistOps.cend())
-      {
-        artist = (*it).artist;
-        album = (*it).album;
-        entryData = (*it).imageData;
-      }
-      else
-      {
-        auto metadata = artistAndAlbumMetadata(albumPath.stem().wstring());
-        if(metadata != std::pair<std::string, std::string>())
+        const auto known = m_folders.find(std::string_view(items[i].path));
+        if(known != m_folders.cend())
         {
-          artist = metadata.first;
-          album = metadata.second;
+          artist = known->second.artist;
+          album = known->second.album;
+          entryData = known->second.imageData;
         }
         else
         {
-          artist = "Unknown";
-          album = albumPath.stem().string();
+          auto metadata = artistAndAlbumMetadata(albumPath.stem().wstring());
+          if(metadata != std::pair<std::string, std::string>())
+          {
+            artist = m_arena.intern(metadata.first);
+            album = m_arena.intern(metadata.second);
+          }
+          else
+          {
+            artist = m_arena.intern("Unknown");
+            album = m_arena.intern(albumPath.stem().string());
+          }
+
+          const auto &image = images[i - first];
+          if(!image.error.isEmpty()) log(image.error);
+          entryData = m_arena.store(image.data);
+
+          m_folders.emplace(m_arena.intern(items[i].path), FolderMetadata{entryData, artist, album});
         }
 
-        entryData = albumBlurhash(albumPath);
-      }
+        if(entryData.empty()) addFailure(ALBUM_KIND, items[i].path, albumPath, "No image");
 
-      operations.emplace_back(albumPath, entryData, artist, album);
+        chunk.albums.push_back(PlaylistImageOperationData{m_arena.path(items[i].path), entryData, artist, album});
 
-      checkProgress(++operationCount);
-    }
+        ++m_operations;
+      }
 
-    checkSQLiteError(result, SQLITE_DONE, __LINE__);
-    result = sqlite3_finalize(statement);
-    checkSQLiteError(result, SQLITE_OK, __LINE__);
+      if(!chunk.albums.empty() && !queue.push(std::move(chunk))) return false;
+    }
   }
 
-  return operations;
+  return true;
 }
 
 
 //---------------------------------------------------------------
-std::vector<TrackNumberOperationData> ProcessThread::generateTracksNumberOperationData()
+bool ProcessThread::generateTracksNumberOperationData(OperationsQueue &queue)
 {
-  std::vector<TrackNumberOperationData> operations;
-
   if(m_config.processTracksNumbers)
   {
-    sqlite3_stmt * statement;
-    const auto sql = std::string("SELECT * FROM ") + TABLE_NAME + " where type='" + TRACK_VALUE + "' AND IndexNumber IS NULL";
-    auto result = sqlite3_prepare_v2(m_sql3Handle, sql.c_str(), -1, &statement, nullptr);
-    if(!checkSQLiteError(result, SQLITE_OK, __LINE__))
-    {
-      m_error = QString("Unable to make SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
-      sqlite3_finalize(statement);
-      return operations;
-    }
-
-    while ((result = sqlite3_step(statement)) == SQLITE_ROW)
+    OperationsChunk chunk;
+    for(const auto &item: m_items.tracks)
     {
-      if(m_abort)
-      {
-        m_error = "Aborted operation.";
-        sqlite3_finalize(statement);
-        return operations;
-      }
+      if(m_abort) return false;
 
-      auto pathValue = reinterpret_cast<const char *>(sqlite3_column_text(statement, 4));
-
-      const std::filesystem::path trackPath(pathValue);
+      const std::filesystem::path trackPath(item.path);
+      m_metrics.add(Metrics::FILESYSTEM_CALLS);
       if(!std::filesystem::exists(trackPath))
       {
-        emit message(QString("<span style=\" color:#ff0000;\">Track path <b>'%1'</b> doesn't exist!</span>").arg(QString::fromStdWString(trackPath.wstring())));
+        log(QString("<span style=\" color:#ff0000;\">Track path <b>'%1'</b> doesn't exist!</span>").arg(QString::fromStdWString(trackPath.wstring())));
+        addFailure(TRACK_KIND, item.path, trackPath.parent_path(), "Track path doesn't exist");
         continue;
       }
 
@@ -401,7 +1038,8 @@ std::vector<TrackNumberOperationData> ProcessThread::generateTracksNumberOperati
       const auto parts = trackName.split(" - ");
       if(parts.size() < 2)
       {
-        emit message(QString("<span style=\" color:#ff0000;\">Track path <b>'%1'</b> split error!</span>").arg(QString::fromStdWString(trackPath.wstring())));
+        log(QString("<span style=\" color:#ff0000;\">Track path <b>'%1'</b> split error!</span>").arg(QString::fromStdWString(trackPath.wstring())));
+        addFailure(TRACK_KIND, item.path, trackPath.parent_path(), "Track name split error");
         continue;
       }
 
@@ -417,20 +1055,7 @@ std::vector<TrackNumberOperationData> ProcessThread::generateTracksNumberOperati
         }
         else
         {
-          std::set<std::filesystem::path> filenames; // ordered by name by default.
-          for (auto const& dir_entry : std::filesystem::directory_iterator{trackPath.parent_path()})
-            filenames.insert(dir_entry.path());
-
-          int fileCount = 1;
-          for(auto sPath: filenames)
-          {
-            if(sPath.extension() != L".mp3") continue;
-            if(sPath == trackPath)
-              break;
-            ++fileCount;
-          }
-
-          trackNum = fileCount;
+          trackNum = m_directories.trackPosition(trackPath);
         }
       }
       else
@@ -438,147 +1063,154 @@ std::vector<TrackNumberOperationData> ProcessThread::generateTracksNumberOperati
         trackNum = numberPart.toInt();
       }
 
-      operations.emplace_back(trackPath, trackNum);
+      chunk.tracks.push_back(TrackNumberOperationData{m_arena.path(item.path), static_cast<unsigned int>(trackNum)});
+
+      ++m_operations;
 
-      checkProgress(++operationCount);
+      if(chunk.tracks.size() == OPERATIONS_PER_CHUNK)
+      {
+        if(!queue.push(std::move(chunk))) return false;
+        chunk = OperationsChunk();
+      }
     }
 
-    checkSQLiteError(result, SQLITE_DONE, __LINE__);
-    result = sqlite3_finalize(statement);
-    checkSQLiteError(result, SQLITE_OK, __LINE__);
+    if(!chunk.tracks.empty() && !queue.push(std::move(chunk))) return false;
   }
 
-  return operations;
+  return true;
 }
 
 //---------------------------------------------------------------
-std::vector<PlaylistTracksOperationData> ProcessThread::generatePlaylistTracksOperations()
+bool ProcessThread::generatePlaylistTracksOperations(OperationsQueue &queue)
 {
-  std::vector<PlaylistTracksOperationData> operations;
-
   if(m_config.processPlaylistTracklist)
   {
-    sqlite3_stmt *statement;
-    auto sql = std::string("SELECT * FROM ") + TABLE_NAME + std::string(" WHERE type='") + PLAYLIST_VALUE + "' AND data=X'" + EMPTY_PLAYLIST_BLOB + "'";
-    auto result = sqlite3_prepare_v2(m_sql3Handle, sql.c_str(), -1, &statement, nullptr);
-    if(!checkSQLiteError(result,  SQLITE_OK, __LINE__))
+    OperationsChunk chunk;
+    for(const auto &item: m_items.tracklists)
     {
-      m_error = QString("Unable to make SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
-      sqlite3_finalize(statement);
-      abort();
-      return operations;
-    }
+      if(m_abort) return false;
 
-    while ((result = sqlite3_step(statement)) == SQLITE_ROW)
-    {
-      if(m_abort)
+      std::filesystem::path playlistPath{item.path};
+      const auto listing = m_directories.listing(playlistPath.parent_path());
+      if(!listing->exists)
       {
-        m_error = "Aborted operation.";
-        sqlite3_finalize(statement);
-        return operations;
+        addFailure(TRACKLIST_KIND, item.path, playlistPath.parent_path(), "Playlist folder doesn't exist");
+        continue;
       }
 
-      auto pathValue = reinterpret_cast<const char *>(sqlite3_column_text(statement, 4));
-      std::filesystem::path playlistPath{pathValue};
-      if(!std::filesystem::exists(playlistPath.parent_path())) continue;
+      // The tracks of the listing are already ordered by name.
+      PlaylistTracksOperationData operation{m_arena.path(item.path), {}, {}};
+      operation.tracks.reserve(listing->tracks.size());
+      for(const auto &track: listing->tracks)
+        operation.tracks.push_back(m_arena.store(track.filename().string()));
 
-      std::set<std::filesystem::path> filenames; // ordered by name by default
-      for (auto const& dir_entry : std::filesystem::directory_iterator{playlistPath.parent_path()})
-        if(dir_entry.path().extension() == L".mp3")
-          filenames.insert(dir_entry.path());
-
-      operations.emplace_back(playlistPath, filenames);
-    }
+      chunk.tracklists.push_back(std::move(operation));
 
-    if (result != SQLITE_DONE && !m_abort)
-    {
-      m_error = QString("Unable to finish step SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
-    }
-    result = sqlite3_finalize(statement);
-    if(result != SQLITE_OK)
-    {
-      m_error = QString("Unable to finalize SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
-    }
+      ++m_operations;
 
-    // Fill missing file ids.
-    sql = std::string("SELECT * FROM ") + TABLE_NAME + std::string(" WHERE type='") + TRACK_VALUE + "' AND path=:path";
-    result = sqlite3_prepare_v3(m_sql3Handle, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &statement, NULL);
-    checkSQLiteError(result, SQLITE_OK, __LINE__);
-    const int pathIdx = sqlite3_bind_parameter_index(statement, ":path");
-    checkSQLiteError(result, SQLITE_OK, __LINE__);
-    for(auto &op: operations)
-    {
-      if(m_abort)
+      if(chunk.tracklists.size() == OPERATIONS_PER_CHUNK)
       {
-        m_error = "Aborted operation.";
-        sqlite3_finalize(statement);
-        return operations;
+        if(!queue.push(std::move(chunk))) return false;
+        chunk = OperationsChunk();
       }
+    }
 
-      emit message(QString("Generate track information of playlist <b>'%1'</b>.").arg(QString::fromStdWString(op.path.filename().wstring())));
+    if(!chunk.tracklists.empty() && !queue.push(std::move(chunk))) return false;
+  }
 
-      for(auto &track: op.tracks)
-      {
-        result = sqlite3_bind_text(statement, pathIdx, track.string().c_str(), track.string().length(), SQLITE_TRANSIENT);
-        checkSQLiteError(result, SQLITE_OK, __LINE__);
+  return true;
+}
 
-        result = sqlite3_step(statement);
-        checkSQLiteError(result, SQLITE_ROW, __LINE__);
+//---------------------------------------------------------------
+bool ProcessThread::resolveTrackIds(const std::set<std::string> &paths, std::unordered_map<std::string, std::string> &ids)
+{
+  auto exec = [this](const std::string &sql)
+  { return checkSQLiteError(sqlite3_exec(m_sql3Handle, sql.c_str(), nullptr, nullptr, nullptr), SQLITE_OK, __LINE__); };
 
-        auto idValue = reinterpret_cast<const char *>(sqlite3_column_text(statement, 46));
-        op.track_ids.emplace_back(std::string(idValue));
+  // The temporary table lives in the temp database, the main database is not modified. A savepoint
+  // instead of a transaction as the writer can have one open.
+  if(!exec("CREATE TEMP TABLE IF NOT EXISTS WantedPaths (Path TEXT PRIMARY KEY) WITHOUT ROWID") ||
+     !exec("DELETE FROM temp.WantedPaths") || !exec("SAVEPOINT WantedPaths")) return false;
 
-        // This should return done, as we just get one row.
-        result = sqlite3_step(statement);
-        checkSQLiteError(result, SQLITE_DONE, __LINE__);
+  sqlite3_stmt *statement;
+  auto result = sqlite3_prepare_v2(m_sql3Handle, "INSERT OR IGNORE INTO temp.WantedPaths VALUES (?1)", -1, &statement, nullptr);
+  if(!checkSQLiteError(result, SQLITE_OK, __LINE__))
+  {
+    exec("ROLLBACK TO WantedPaths");
+    exec("RELEASE WantedPaths");
+    return false;
+  }
 
-        result = sqlite3_clear_bindings( statement );
-        checkSQLiteError(result, SQLITE_OK, __LINE__);
-        result = sqlite3_reset( statement );
-        checkSQLiteError(result, SQLITE_OK, __LINE__);
-      }
+  for(const auto &path: paths)
+  {
+    sqlite3_bind_text(statement, 1, path.c_str(), path.length(), SQLITE_STATIC);
+    result = step(statement);
+    sqlite3_reset(statement);
+    if(!checkSQLiteError(result, SQLITE_DONE, __LINE__)) break;
+  }
+  sqlite3_finalize(statement);
 
-      checkProgress(++operationCount);
-    }
+  if(!m_error.isEmpty())
+  {
+    exec("ROLLBACK TO WantedPaths");
+    exec("RELEASE WantedPaths");
+    return false;
+  }
+  if(!exec("RELEASE WantedPaths")) return false;
 
-    result = sqlite3_finalize(statement);
-    if(result != SQLITE_OK)
-    {
-      m_error = QString("Unable to finalize SQL statement. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errstr(result)));
-    }
+  // Single pass over the items table, each row probes the wanted paths primary key.
+  const auto sql = std::string("SELECT t.") + PATH_COLUMN + ", t." + ID_COLUMN + " FROM " + TABLE_NAME + " t JOIN temp.WantedPaths w ON t."
+                 + PATH_COLUMN + "=w.Path WHERE t." + TYPE_COLUMN + "='" + TRACK_VALUE + "'";
+  result = sqlite3_prepare_v2(m_sql3Handle, sql.c_str(), -1, &statement, nullptr);
+  if(!checkSQLiteError(result, SQLITE_OK, __LINE__)) return false;
+
+  while((result = step(statement)) == SQLITE_ROW)
+  {
+    const auto path = reinterpret_cast<const char *>(sqlite3_column_text(statement, 0));
+    const auto id = reinterpret_cast<const char *>(sqlite3_column_text(statement, 1));
+    if(path && id) ids.emplace(path, id);
   }
+  sqlite3_finalize(statement);
 
-  return operations;
+  exec("DROP TABLE temp.WantedPaths");
+
+  return checkSQLiteError(result, SQLITE_DONE, __LINE__);
 }
 
 //---------------------------------------------------------------
-void ProcessThread::updatePlaylistImages(const std::vector<PlaylistImageOperationData> &operations)
+unsigned long ProcessThread::updatePlaylistImages(const std::vector<PlaylistImageOperationData> &operations)
 {
-  const std::string ARTISTS_PART = m_config.processTracksArtists ? "Artists = :artist, AlbumArtists=:artist, Album = :album,":"";
-  const std::string IMAGES_PART = m_config.processPlaylistImages ? "Images = :image":"";
-  const std::string sql = std::string("UPDATE ") + TABLE_NAME + " SET " + ARTISTS_PART + " " + IMAGES_PART + " WHERE Path LIKE :path AND MediaType = 'Audio'";
+  const std::string sql = updateSql(metadataColumns(), "Path >= :path AND Path < :pathEnd AND MediaType = 'Audio'");
 
   sqlite3_stmt * statement;
   auto result = sqlite3_prepare_v3(m_sql3Handle, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &statement, NULL);
 
+  unsigned long updated = 0;
+
   for(auto &op: operations)
   {
     if(m_abort)
     {
       m_error = "Aborted operation.";
-      return;
+      sqlite3_finalize(statement);
+      return updated;
     }
 
     // For debug
     // std::cout << "Operation: " << op.path.string() << std::endl;
 
-    emit message(QString("Apply update for <b>'%1'</b> playlist metadata.").arg(QString::fromStdWString(op.path.parent_path().stem().wstring())));
+    const std::filesystem::path folder(std::string(op.path.parent()));
+    log(QString("Apply update for <b>'%1'</b> playlist metadata.").arg(QString::fromStdWString(folder.stem().wstring())));
 
-    const auto path = op.path.parent_path().string() + "\\%";
+    // Half-open range of the paths starting with the folder path, can use an index on Path.
+    // The range ends in the code point that follows the separator, ']' on Windows.
+    const auto path = std::string(op.path.folder);
+    const auto pathEnd = std::string(op.path.parent()) + static_cast<char>(path.back() + 1);
 
-    ++operationCount;
+    ++m_operations;
 
-    if(!std::filesystem::exists(op.path.parent_path())) continue;
+    m_metrics.add(Metrics::FILESYSTEM_CALLS);
+    if(op.path.folder.empty() || !std::filesystem::exists(folder)) continue;
 
     int artistIdx = 0, albumIdx = 0, imageIdx = 0;
 
@@ -598,39 +1230,49 @@ void ProcessThread::updatePlaylistImages(const std::vector<PlaylistImageOperatio
 
     const auto pathIdx = sqlite3_bind_parameter_index(statement, ":path");
     checkSQLiteError(result, SQLITE_OK, __LINE__);
+    const auto pathEndIdx = sqlite3_bind_parameter_index(statement, ":pathEnd");
+    checkSQLiteError(result, SQLITE_OK, __LINE__);
 
     if(m_config.processTracksArtists)
     {
-      result = sqlite3_bind_text(statement, artistIdx, op.artist.c_str(), op.artist.length(), SQLITE_TRANSIENT);
+      result = bindText(statement, artistIdx, op.artist);
       checkSQLiteError(result, SQLITE_OK, __LINE__);
-      result = sqlite3_bind_text(statement, albumIdx, op.album.c_str(), op.album.length(), SQLITE_TRANSIENT);
+      result = bindText(statement, albumIdx, op.album);
       checkSQLiteError(result, SQLITE_OK, __LINE__);
     }
 
     if(m_config.processPlaylistImages)
     {
-      result = sqlite3_bind_text(statement, imageIdx, op.imageData.c_str(), op.imageData.length(), SQLITE_TRANSIENT);
+      result = bindText(statement, imageIdx, op.imageData);
       checkSQLiteError(result, SQLITE_OK, __LINE__);
     }
 
     result = sqlite3_bind_text(statement, pathIdx, path.c_str(), path.length(), SQLITE_TRANSIENT);
     checkSQLiteError(result, SQLITE_OK, __LINE__);
+    result = sqlite3_bind_text(statement, pathEndIdx, pathEnd.c_str(), pathEnd.length(), SQLITE_TRANSIENT);
+    checkSQLiteError(result, SQLITE_OK, __LINE__);
 
     // For debug
     // std::cout << sqlite3_expanded_sql(statement) << std::endl;
 
-    result = sqlite3_step(statement);
+    if(!beginWrite()) break;
+
+    result = applyUpdate(statement);
     checkSQLiteError(result, SQLITE_DONE, __LINE__);
+
+    endWrite(op.artist.length() + op.album.length() + op.imageData.length() + path.length());
+    ++updated;
+
     result = sqlite3_clear_bindings( statement );
     checkSQLiteError(result, SQLITE_OK, __LINE__);
     result = sqlite3_reset( statement );
     checkSQLiteError(result, SQLITE_OK, __LINE__);
-
-    checkProgress(operationCount);
   }
 
   result = sqlite3_finalize(statement);
   checkSQLiteError(result, SQLITE_OK, __LINE__);
+
+  return updated;
 }
 
 //---------------------------------------------------------------
@@ -638,10 +1280,7 @@ void ProcessThread::updateAlbumOperations(const std::vector<PlaylistImageOperati
 {
   if(m_config.processAlbums)
   {
-    const std::string ARTISTS_PART = m_config.processTracksArtists ? "Artists = :artist, AlbumArtists=:artist, Album = :album,":"";
-    const std::string IMAGES_PART = m_config.processPlaylistImages ? "Images = :image":"";
-    const std::string sql = std::string("UPDATE ") + TABLE_NAME + " SET " + ARTISTS_PART + " " + IMAGES_PART
-                          + " WHERE Path = :path " + "AND MediaType IS NULL AND type ='" + ALBUM_VALUE + "'";
+    const std::string sql = updateSql(metadataColumns(), std::string("Path = :path AND MediaType IS NULL AND type ='") + ALBUM_VALUE + "'");
 
     sqlite3_stmt * statement;
     auto result = sqlite3_prepare_v3(m_sql3Handle, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &statement, NULL);
@@ -655,13 +1294,15 @@ void ProcessThread::updateAlbumOperations(const std::vector<PlaylistImageOperati
         return;
       }
 
-      emit message(QString("Apply update for <b>'%1'</b> album metadata.").arg(QString::fromStdWString(op.path.stem().wstring())));
+      const auto albumPath = op.path.path();
+      log(QString("Apply update for <b>'%1'</b> album metadata.").arg(QString::fromStdWString(albumPath.stem().wstring())));
 
-      const auto path = std::filesystem::canonical(op.path).string();
+      const auto path = std::filesystem::canonical(albumPath).string();
 
-      ++operationCount;
+      ++m_operations;
 
-      if(!std::filesystem::exists(op.path)) continue;
+      m_metrics.add(Metrics::FILESYSTEM_CALLS, 2);
+      if(!std::filesystem::exists(albumPath)) continue;
 
       int artistIdx = 0, albumIdx = 0, imageIdx = 0;
 
@@ -681,15 +1322,15 @@ void ProcessThread::updateAlbumOperations(const std::vector<PlaylistImageOperati
 
       if(m_config.processTracksArtists)
       {
-        result = sqlite3_bind_text(statement, artistIdx, op.artist.c_str(), op.artist.length(), SQLITE_TRANSIENT);
+        result = bindText(statement, artistIdx, op.artist);
         checkSQLiteError(result, SQLITE_OK, __LINE__);
-        result = sqlite3_bind_text(statement, albumIdx, op.album.c_str(), op.album.length(), SQLITE_TRANSIENT);
+        result = bindText(statement, albumIdx, op.album);
         checkSQLiteError(result, SQLITE_OK, __LINE__);
       }
 
       if(m_config.processPlaylistImages)
       {
-        result = sqlite3_bind_text(statement, imageIdx, op.imageData.c_str(), op.imageData.length(), SQLITE_TRANSIENT);
+        result = bindText(statement, imageIdx, op.imageData);
         checkSQLiteError(result, SQLITE_OK, __LINE__);
       }
 
@@ -699,14 +1340,17 @@ void ProcessThread::updateAlbumOperations(const std::vector<PlaylistImageOperati
       // For debug
       //std::cout << sqlite3_expanded_sql(statement) << std::endl;
 
-      result = sqlite3_step(statement);
+      if(!beginWrite()) break;
+
+      result = applyUpdate(statement);
       checkSQLiteError(result, SQLITE_DONE, __LINE__);
+
+      endWrite(op.artist.length() + op.album.length() + op.imageData.length() + path.length());
+
       result = sqlite3_clear_bindings( statement );
       checkSQLiteError(result, SQLITE_OK, __LINE__);
       result = sqlite3_reset( statement );
       checkSQLiteError(result, SQLITE_OK, __LINE__);
-
-      checkProgress(operationCount);
     }
 
     result = sqlite3_finalize(statement);
@@ -719,8 +1363,7 @@ void ProcessThread::updateTrackNumbers(const std::vector<TrackNumberOperationDat
 {
   if(m_config.processTracksNumbers)
   {
-    const std::string sql = std::string("UPDATE ") + TABLE_NAME + " SET IndexNumber=:index WHERE Path = :path AND type='"
-                          + TRACK_VALUE + "'";
+    const std::string sql = updateSql({{"IndexNumber", ":index"}}, std::string("Path = :path AND type='") + TRACK_VALUE + "'");
 
     sqlite3_stmt * statement;
     auto result = sqlite3_prepare_v3(m_sql3Handle, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &statement, NULL);
@@ -736,25 +1379,32 @@ void ProcessThread::updateTrackNumbers(const std::vector<TrackNumberOperationDat
         return;
       }
 
+      const auto path = op.path.string();
+
       result = sqlite3_bind_int(statement, indexIdx, op.trackNum);
       checkSQLiteError(result, SQLITE_OK, __LINE__);
-      result = sqlite3_bind_text(statement, pathIdx, op.path.string().c_str(), op.path.string().length(), SQLITE_TRANSIENT);
+      result = sqlite3_bind_text(statement, pathIdx, path.c_str(), path.length(), SQLITE_TRANSIENT);
       checkSQLiteError(result, SQLITE_OK, __LINE__);
 
-      const auto trackName = QString::fromStdString(op.path.stem().string());
-      emit message(QString("Apply update for <b>'%1'</b> track, track number is %2.").arg(trackName).arg(op.trackNum));
+      const auto trackName = QString::fromStdString(std::filesystem::path(std::string(op.path.name)).stem().string());
+      log(QString("Apply update for <b>'%1'</b> track, track number is %2.").arg(trackName).arg(op.trackNum));
 
       // For debug
       //std::cout << sqlite3_expanded_sql(statement) << std::endl;
 
-      result = sqlite3_step(statement);
+      if(!beginWrite()) break;
+
+      result = applyUpdate(statement);
       checkSQLiteError(result, SQLITE_DONE, __LINE__);
+
+      endWrite(sizeof(op.trackNum) + path.length());
+
       result = sqlite3_clear_bindings( statement );
       checkSQLiteError(result, SQLITE_OK, __LINE__);
       result = sqlite3_reset( statement );
       checkSQLiteError(result, SQLITE_OK, __LINE__);
 
-      checkProgress(++operationCount);
+      ++m_operations;
     }
 
     result = sqlite3_finalize(statement);
@@ -763,13 +1413,48 @@ void ProcessThread::updateTrackNumbers(const std::vector<TrackNumberOperationDat
 }
 
 //---------------------------------------------------------------
-void ProcessThread::updatePlaylistTracks(const std::vector<PlaylistTracksOperationData> &operations)
+void ProcessThread::updatePlaylistTracks(std::vector<PlaylistTracksOperationData> &operations)
 {
   if(m_config.processPlaylistTracklist)
   {
+    // Fill missing file ids, resolved in a single query.
+    std::set<std::string> wanted;
+    for(const auto &op: operations)
+      for(const auto &track: op.tracks)
+        wanted.insert(std::string(op.path.folder).append(track));
+
+    std::unordered_map<std::string, std::string> ids;
+    if(!resolveTrackIds(wanted, ids))
+    {
+      log(QString("<span style=\" color:#ff0000;\">Unable to find the tracks of the playlists in the database. %1</span>").arg(m_error));
+      abort();
+      return;
+    }
+
+    for(auto &op: operations)
+    {
+      log(QString("Generate track information of playlist <b>'%1'</b>.").arg(pathText(op.path.name)));
+
+      // Tracks not in the database can't be linked to the playlist.
+      size_t found = 0;
+      for(const auto &track: op.tracks)
+      {
+        const auto trackPath = std::string(op.path.folder).append(track);
+        const auto id = ids.find(trackPath);
+        if(id == ids.cend())
+        {
+          log(QString("<span style=\" color:#ff0000;\">Track <b>'%1'</b> not found in the database.</span>").arg(pathText(trackPath)));
+          continue;
+        }
+
+        op.tracks[found++] = track;
+        op.track_ids.push_back(m_arena.store(id->second));
+      }
+      op.tracks.resize(found);
+    }
+
     sqlite3_stmt *statement;
-    const std::string sql = std::string("UPDATE ") + TABLE_NAME + " SET data=:data WHERE path=:path AND type='"
-        + PLAYLIST_VALUE + "'";
+    const std::string sql = updateSql({{"data", ":data"}}, std::string("path=:path AND type='") + PLAYLIST_VALUE + "'");
 
     auto result = sqlite3_prepare_v3(m_sql3Handle, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &statement, NULL);
 
@@ -783,11 +1468,11 @@ void ProcessThread::updatePlaylistTracks(const std::vector<PlaylistTracksOperati
       if(m_abort)
       {
         m_error = "Aborted operation.";
+        sqlite3_finalize(statement);
         return;
       }
 
-      // For debug
-      emit message(QString("Apply update for <b>'%1'</b> playlist tracks list.").arg(QString::fromStdWString(op.path.parent_path().stem().wstring())));
+      log(QString("Apply update for <b>'%1'</b> playlist tracks list.").arg(QString::fromStdWString(std::filesystem::path(std::string(op.path.parent())).stem().wstring())));
 
       QJsonParseError parseError;
       QByteArray ba = QByteArray::fromRawData(EMPTY_PLAYLIST_TEXT.c_str(), EMPTY_PLAYLIST_TEXT.length());
@@ -795,19 +1480,19 @@ void ProcessThread::updatePlaylistTracks(const std::vector<PlaylistTracksOperati
 
       if(jsonDoc.isNull())
       {
-        emit message(QString("<span style=\" color:#ff0000;\">Playlist tracklist JSON is null! Path is <b>'%1'</b>, parse error is %2.</span>")
-                .arg(QString::fromStdWString(op.path.wstring())).arg(parseError.errorString()));
+        log(QString("<span style=\" color:#ff0000;\">Playlist tracklist JSON is null! Path is <b>'%1'</b>, parse error is %2.</span>")
+                .arg(pathText(op.path.string())).arg(parseError.errorString()));
         continue;
       }
 
       int i = 0;
       QJsonArray trackList;
-      for(const auto &trackPath: op.tracks)
+      for(const auto &trackName: op.tracks)
       {
         QJsonObject track;
-        track["Path"] = QString::fromStdWString(trackPath.filename().wstring());
+        track["Path"] = pathText(trackName);
         track["Type"] = QString("Manual");
-        track["ItemId"] = QString::fromStdString(op.track_ids[i++]);
+        track["ItemId"] = QString::fromStdString(std::string(op.track_ids[i++]));
 
         trackList.push_back(track);
       }
@@ -817,7 +1502,8 @@ void ProcessThread::updatePlaylistTracks(const std::vector<PlaylistTracksOperati
 
       jsonDoc = QJsonDocument(rootJson);
 
-      result = sqlite3_bind_text(statement, pathIdx, op.path.string().c_str(), op.path.string().length(), SQLITE_TRANSIENT);
+      const auto path = op.path.string();
+      result = sqlite3_bind_text(statement, pathIdx, path.c_str(), path.length(), SQLITE_TRANSIENT);
       checkSQLiteError(result, SQLITE_OK, __LINE__);
 
       const auto jsonData = jsonDoc.toJson(QJsonDocument::Compact);
@@ -827,14 +1513,19 @@ void ProcessThread::updatePlaylistTracks(const std::vector<PlaylistTracksOperati
       // For debug
       // std::cout << sqlite3_expanded_sql(statement) << std::endl;
 
-      result = sqlite3_step(statement);
+      if(!beginWrite()) break;
+
+      result = applyUpdate(statement);
       checkSQLiteError(result, SQLITE_DONE, __LINE__);
+
+      endWrite(jsonData.length() + path.length());
+
       result = sqlite3_clear_bindings( statement );
       checkSQLiteError(result, SQLITE_OK, __LINE__);
       result = sqlite3_reset( statement );
       checkSQLiteError(result, SQLITE_OK, __LINE__);
 
-      checkProgress(++operationCount);
+      ++m_operations;
     }
 
     result = sqlite3_finalize(statement);
@@ -843,53 +1534,107 @@ void ProcessThread::updatePlaylistTracks(const std::vector<PlaylistTracksOperati
 }
 
 //---------------------------------------------------------------
-void ProcessThread::countOperations()
+void ProcessThread::scanItems()
 {
+  m_items = DatabaseItems();
+
+  const std::string MISSING_METADATA = "(Images IS NULL OR Album IS NULL OR Artists IS NULL)";
+
+  std::vector<std::string> conditions;
   if(m_config.processPlaylistImages)
-  {
-    const auto where_sql = std::string(" where type='") + PLAYLIST_VALUE + "' AND (Images IS NULL OR Album IS NULL OR Artists IS NULL)";
-    const auto playlistCount = countSQLiteOperation(where_sql);
-    emit message(QString("Found <b>%1</b> playlists to update image, artists and album metadata.").arg(playlistCount));
-    totalOperations += 2*playlistCount; // generate + apply
-  }
+    conditions.emplace_back("(type='" + PLAYLIST_VALUE + "' AND " + MISSING_METADATA + ")");
 
   if(m_config.processPlaylistTracklist)
+    conditions.emplace_back("(type='" + PLAYLIST_VALUE + "' AND data=X'" + EMPTY_PLAYLIST_BLOB + "')");
+
+  if(m_config.processTracksNumbers)
+    conditions.emplace_back("(type='" + TRACK_VALUE + "' AND IndexNumber IS NULL)");
+
+  if(m_config.processAlbums)
+    conditions.emplace_back("(type='" + ALBUM_VALUE + "' AND " + MISSING_METADATA + ")");
+
+  if(conditions.empty()) return;
+
+  std::string where_sql = " WHERE ";
+  for(unsigned int i = 0; i < conditions.size(); ++i)
+    where_sql += (i == 0 ? "" : " OR ") + conditions[i];
+
+  ItemsReader reader(m_sql3Handle, where_sql, m_state ? m_state->watermark() : std::string());
+
+  unsigned long skipped = 0;
+  auto consider = [this, &skipped](const std::string &kind, const ItemData &item)
+  {
+    const bool known = isKnownFailure(kind, item);
+    if(known) ++skipped;
+
+    return !known;
+  };
+
+  ItemData item;
+  while(reader.next(item))
   {
-    const auto where_sql = std::string(" where type='") + PLAYLIST_VALUE + "' AND data=X'" + EMPTY_PLAYLIST_BLOB + "'";
-    const auto tracklistsCount = countSQLiteOperation(where_sql);
-    emit message(QString("Found <b>%1</b> playlist to update audio tracks list.").arg(tracklistsCount));
-    totalOperations += 2*tracklistsCount; // generate + apply
+    m_metrics.add(Metrics::ROWS_SCANNED);
+
+    if(m_abort)
+    {
+      m_error = "Aborted operation.";
+      return;
+    }
+
+    switch(item.type)
+    {
+      case ItemType::PLAYLIST:
+        if(m_config.processPlaylistImages && (!item.hasImages || !item.hasAlbum || !item.hasArtists) && consider(PLAYLIST_KIND, item))
+          m_items.playlists.push_back(item);
+        if(m_config.processPlaylistTracklist && item.emptyPlaylist && consider(TRACKLIST_KIND, item))
+          m_items.tracklists.push_back(item);
+        break;
+      case ItemType::ALBUM:
+        if(consider(ALBUM_KIND, item)) m_items.albums.push_back(item);
+        break;
+      case ItemType::TRACK:
+        if(consider(TRACK_KIND, item)) m_items.tracks.push_back(item);
+        break;
+      default:
+        break;
+    }
   }
 
-  if(m_config.processTracksNumbers)
+  // Steps of the items reader, one per row and the last one.
+  m_metrics.add(Metrics::SQLITE_STEPS, m_metrics.value(Metrics::ROWS_SCANNED) + 1);
+
+  if(!reader.error().isEmpty())
   {
-    const auto where_sql = std::string(" where type='") + TRACK_VALUE + "' AND IndexNumber IS NULL";
-    const auto tracksCount = countSQLiteOperation(where_sql);
-    emit message(QString("Found <b>%1</b> tracks to update track number.").arg(tracksCount));
-    totalOperations += 2*tracksCount; // generate + apply
+    m_error = reader.error();
+    return;
   }
 
-  if(m_config.processAlbums)
+  if(skipped > 0)
+    log(QString("Skipped <b>%1</b> items that failed in the last run and haven't changed.").arg(skipped));
+
+  if(m_config.processPlaylistImages)
   {
-    const auto where_sql = std::string(" where type='") + ALBUM_VALUE + "' AND (Images IS NULL OR Album IS NULL OR Artists IS NULL)";
-    const auto albumsCount = countSQLiteOperation(where_sql);
-    emit message(QString("Found <b>%1</b> albums to update image, artists and album metadata.").arg(albumsCount));
-    totalOperations += albumsCount; // apply
+    log(QString("Found <b>%1</b> playlists to update image, artists and album metadata.").arg(m_items.playlists.size()));
+    m_totalOperations += 2*m_items.playlists.size(); // generate + apply
   }
 
-}
+  if(m_config.processPlaylistTracklist)
+  {
+    log(QString("Found <b>%1</b> playlist to update audio tracks list.").arg(m_items.tracklists.size()));
+    m_totalOperations += 2*m_items.tracklists.size(); // generate + apply
+  }
 
-//---------------------------------------------------------------
-void ProcessThread::checkProgress(const unsigned long operationNumber)
-{
-  const int progressValue = (operationNumber * 100)/totalOperations;
-  if(currentProgress != progressValue)
+  if(m_config.processTracksNumbers)
   {
-    currentProgress = progressValue;
-    emit progress(currentProgress);
+    log(QString("Found <b>%1</b> tracks to update track number.").arg(m_items.tracks.size()));
+    m_totalOperations += 2*m_items.tracks.size(); // generate + apply
   }
 
-  QCoreApplication::processEvents();
+  if(m_config.processAlbums)
+  {
+    log(QString("Found <b>%1</b> albums to update image, artists and album metadata.").arg(m_items.albums.size()));
+    m_totalOperations += m_items.albums.size(); // apply
+  }
 }
 
 //---------------------------------------------------------------
@@ -908,87 +1653,140 @@ std::pair<std::string, std::string> ProcessThread::artistAndAlbumMetadata(const
 }
 
 //---------------------------------------------------------------
-std::string ProcessThread::albumBlurhash(const std::filesystem::path &path)
+FolderImage ProcessThread::folderImage(const std::filesystem::path &path) const
 {
-  std::string result;
+  FolderImage image;
+  image.exists = true;
 
-  std::filesystem::path imagePath;
-  for (auto const& dir_entry : std::filesystem::directory_iterator{path})
+  try
   {
-    if(dir_entry.path().string().find(m_config.imageName.toStdString()) != std::string::npos)
-    {
-      imagePath = dir_entry.path();
-      break;
-    }
+    image.data = albumBlurhash(path, image.error);
   }
-
-  // If Image is empty, found a "Default.png" in the parent directories.
-  auto backtracePath = path;
-  while(imagePath.empty() && backtracePath != backtracePath.root_path())
+  catch(const std::exception &e)
   {
-    auto frontalPath = backtracePath;
-    frontalPath /= "Default.png";
-    if(std::filesystem::exists(frontalPath))
-    {
-      imagePath = frontalPath;
-      break;
-    }
-
-    backtracePath = backtracePath.parent_path();
+    image.error = QString("<span style=\" color:#ff0000;\">Unable to compute image of <b>'%1'</b>. Exception: %2</span>")
+                    .arg(QString::fromStdWString(path.wstring())).arg(QString::fromLatin1(e.what()));
   }
 
+  return image;
+}
+
+//---------------------------------------------------------------
+std::string ProcessThread::albumBlurhash(const std::filesystem::path &path, QString &error) const
+{
+  std::string result;
+
+  // If no image is found, use a "Default.png" in the folder or the parent directories.
+  Metrics::ScopedTimer findTimer(m_metrics, Metrics::FIND_IMAGE);
+  auto imagePath = m_directories.image(path, m_config.imageName.toStdString());
+  if(imagePath.empty()) imagePath = m_directories.defaultImage(path);
+  findTimer.stop();
+
   if(!imagePath.empty())
   {
-    int width, height, n;
-    char utfImagePath[1024];
-    stbi_convert_wchar_to_utf8(utfImagePath, 1024, imagePath.wstring().c_str());
-    unsigned char *imageData = stbi_load(utfImagePath, &width, &height, &n, 3);
-
-    if (!imageData)
+    // Stack overflow: https://stackoverflow.com/questions/26109330/datetime-equivalent-in-c
+    // To transform the time in 'ticks'.
+    Metrics::ScopedTimer statTimer(m_metrics, Metrics::STAT);
+    QFileInfo file(QString::fromStdWString(imagePath.wstring()));
+    const auto writeTime = (file.lastModified().toMSecsSinceEpoch() * 10000) + 621355968000009999;
+
+    BlurhashKey key;
+    key.path = std::filesystem::canonical(imagePath).string();
+    key.size = static_cast<unsigned long>(file.size());
+    key.writeTime = writeTime;
+    key.workSize = m_config.blurhashImageSize;
+    statTimer.stop();
+    m_metrics.add(Metrics::FILESYSTEM_CALLS, 2);
+
+    BlurhashValue value;
+    if(!m_cache || !m_cache->find(key, value))
     {
-      emit message(QString("Unable to load image <b>'%1'</b>.").arg(QString::fromStdString(imagePath.string())));
-    }
-    else if(n != 3)
-    {
-      emit message(QString("Couldn't decode <b>'%1'</b> to 3 channel RGB.").arg(QString::fromStdString(imagePath.string())));
-      stbi_image_free(imageData);
-    }
-    else
-    {
-      QImage qImage(width, height, QImage::Format_RGB888);
-      memcpy(qImage.bits(), imageData, width*height*3);
+      // The file is mapped in memory, except in network filesystems where it's read in a buffer.
+      // The size is read from the header, only the pixels needed for the blurhash are decoded.
+      ImageInfo info;
+      Metrics::ScopedTimer probeTimer(m_metrics, Metrics::STAT);
+      const ImageFile imageFile(imagePath, !isNetworkFile(imagePath));
+      const bool probed = probeImage(imageFile, info);
+      probeTimer.stop();
+
+      if(!imageFile.isValid())
+      {
+        error = imageFile.error();
+      }
+      else if(!probed)
+      {
+        error = QString("Unable to load image <b>'%1'</b>.").arg(QString::fromStdString(imagePath.string()));
+      }
+      else if(info.components != 3)
+      {
+        error = QString("Couldn't decode <b>'%1'</b> to 3 channel RGB.").arg(QString::fromStdString(imagePath.string()));
+      }
+      else
+      {
+        const int width = info.width;
+        const int height = info.height;
+
+        int x = width;
+        int y = height;
+        if(width == height) { x = y = BLURHASH_MAXSIZE; }
+        else if(width > height) { x /= height; y = BLURHASH_MAXSIZE/x; x = BLURHASH_MAXSIZE; }
+        else { y /= width; x = BLURHASH_MAXSIZE/y; y = BLURHASH_MAXSIZE; }
+
+        // Jellyfin scales down images as making a blurhash from the small one has
+        // the same results as the blurhash of a big image but takes considerably longer.
+        // We do the same, JPEG images are already decoded at a reduced scale if possible.
+        const auto size = scaledSize(width, height, m_config.blurhashImageSize);
+
+        DecodedImage image;
+        Metrics::ScopedTimer decodeTimer(m_metrics, Metrics::DECODE);
+        QString decodeError;
+        const bool loaded = loadImage(imageFile, info, size.first, size.second, image, decodeError);
+        decodeTimer.stop();
+
+        if(!loaded)
+        {
+          error = QString("Unable to load image <b>'%1'</b>: %2").arg(QString::fromStdString(imagePath.string())).arg(decodeError);
+        }
 
-      int x = width;
-      int y = height;
-      if(width == height) { x = y = BLURHASH_MAXSIZE; }
-      else if(width > height) { x /= height; y = BLURHASH_MAXSIZE/x; x = BLURHASH_MAXSIZE; }
-      else { y /= width; x = BLURHASH_MAXSIZE/y; y = BLURHASH_MAXSIZE; }
+        if(loaded)
+        {
+          if(image.scaled) m_metrics.add(Metrics::SCALED_DECODES);
 
-      // Jellyfin scales down images as making a blurhash from the small one has
-      // the same results as the blurhash of a big image but takes considerably longer.
-      // We do the same.
-      qImage.scaledToHeight(x*32, Qt::SmoothTransformation);
-      qImage.toPixelFormat(QImage::Format_RGB888);
+          if(size.first != image.width || size.second != image.height || image.stride != image.width*3)
+          {
+            Metrics::ScopedTimer downscaleTimer(m_metrics, Metrics::DOWNSCALE);
+            auto workImage = downscaleImage(image.pixels.get(), image.width, image.height, image.stride, size.first, size.second);
+            downscaleTimer.stop();
 
-      const auto blurHash = blurhash::encode(qImage.bits(), qImage.width(), qImage.height(), x, y);
+            Metrics::ScopedTimer encodeTimer(m_metrics, Metrics::ENCODE);
+            value.hash = blurhash::encode(workImage.pixels.data(), workImage.width, workImage.height, x, y);
+          }
+          else
+          {
+            Metrics::ScopedTimer encodeTimer(m_metrics, Metrics::ENCODE);
+            value.hash = blurhash::encode(image.pixels.get(), image.width, image.height, x, y);
+          }
 
-      // Stack overflow: https://stackoverflow.com/questions/26109330/datetime-equivalent-in-c
-      // To transform the time in 'ticks'.
-      QFileInfo file(QString::fromStdWString(imagePath.wstring()));
-      const auto writeTime = (file.lastModified().toMSecsSinceEpoch() * 10000) + 621355968000009999;
+          value.width = width;
+          value.height = height;
+          if(m_cache) m_cache->insert(key, value);
+        }
+      }
+    }
 
-      result = std::filesystem::canonical(imagePath).string() + "*" + std::to_string(writeTime)
-          + "*Primary*" + std::to_string(width) + "*" + std::to_string(height) + "*" + blurHash;
+    if(!value.hash.empty())
+    {
+      result = key.path + "*" + std::to_string(writeTime) + "*Primary*" + std::to_string(value.width)
+             + "*" + std::to_string(value.height) + "*" + value.hash;
 
       // For debug
       // std::cout << result << std::endl;
-      stbi_image_free(imageData);
     }
   }
   else
   {
-    emit message(QString("<span style=\" color:#ff0000;\">Unable to assign image to <b>'%1'</b>.</span>")
-                 .arg(QString::fromStdWString(path.wstring())));
+    error = QString("<span style=\" color:#ff0000;\">Unable to assign image to <b>'%1'</b>.</span>")
+              .arg(QString::fromStdWString(path.wstring()));
   }
 
   return result;
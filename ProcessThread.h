@@ -23,6 +23,12 @@
 // Qt
 #include <QThread>
 
+// Project
+#include <ItemsReader.h>
+#include <DirectoryCache.h>
+#include <Metrics.h>
+#include <StringArena.h>
+
 // SQLite3
 #include <sqlite3/sqlite3.h>
 
@@ -30,6 +36,20 @@
 #include <filesystem>
 #include <set>
 #include <map>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <thread>
+
+class BatchWriter;
+class PlanWriter;
+class ChangeJournal;
+class RunState;
+template<class T> class BoundedQueue;
+class ThreadPool;
+class BlurhashCache;
+class LogBuffer;
+class QElapsedTimer;
 
 /** \struct ProcessConfiguration
  * \brief Contains the options of the processing thread.
@@ -43,6 +63,19 @@ struct ProcessConfiguration
     bool processTracksNumbers;     /** true to add item index in tracks entities. */
     bool processAlbums;            /** true to enter artist, album and image metadata in Album entries. */
     QString imageName;
+    int blurhashImageSize;         /** maximum width and height of the image used to compute the blurhash. */
+    unsigned int threads;          /** number of threads used to compute the images, 0 to use the hardware concurrency. */
+    QString cacheFile;             /** blurhash cache file or empty to not use a cache. */
+    bool pathIndex;                /** true to create an index on Path during the updates if the database has none. */
+    unsigned long batchRows;       /** maximum number of update operations per transaction, 0 for no limit. */
+    unsigned long batchBytes;      /** maximum size in bytes of the data written per transaction, 0 for no limit. */
+    QString metricsFile;           /** file to write the metrics of the run as JSON or empty to not write them. */
+    bool bulkProfile;              /** true to tune the connection for bulk updates during the run. */
+    bool dryRun;                   /** true to write the planned changes to the plan file instead of updating the database. */
+    QString planFile;              /** file to write the planned changes in a dry run. */
+    QString journalFile;           /** file to write the previous values of the modified rows or empty to not write it. */
+    QString stateFile;             /** state of the last run to skip the unchanged failed items or empty to process all. */
+    unsigned int queueDepth;       /** maximum number of chunks of generated operations waiting to be applied. */
 
     ProcessConfiguration()
     : processPlaylistImages{true}
@@ -50,20 +83,68 @@ struct ProcessConfiguration
     , processTracksArtists{true}
     , processTracksNumbers{true}
     , processAlbums{true}
+    , blurhashImageSize{128}
+    , threads{std::thread::hardware_concurrency()}
+    , pathIndex{true}
+    , batchRows{5000}
+    , batchBytes{16*1024*1024}
+    , bulkProfile{false}
+    , dryRun{false}
+    , queueDepth{8}
     {};
 };
 
+/** \struct ColumnAssignment
+ * \brief Column modified by an update and the statement parameter with its new value.
+ *
+ */
+struct ColumnAssignment
+{
+    std::string column;    /** column name. */
+    std::string parameter; /** name of the parameter with the new value. */
+};
+
 /** \struct PlaylistOperationData
  * \brief Contains the necesary data to modify playlist/albums and tracks images and artists metadata.
- *  Also used for Album operations as the only thing that changes is the path.
+ *  Also used for Album operations as the only thing that changes is the path. The texts are stored
+ *  in the arena of the process.
  *
  */
 struct PlaylistImageOperationData
 {
-    std::filesystem::path path;      /** path of playlist. */
-    std::string           imageData; /** image data, blurhash etc.. */
-    std::string           artist;    /** playlist artist name. */
-    std::string           album;     /** playlist album title. */
+    ArenaPath        path;      /** path of playlist. */
+    std::string_view imageData; /** image data, blurhash etc.. */
+    std::string_view artist;    /** playlist artist name. */
+    std::string_view album;     /** playlist album title. */
+};
+
+/** \struct FolderMetadata
+ * \brief Image, artist and album data of a folder processed in the run, stored in the arena of the process.
+ *
+ */
+struct FolderMetadata
+{
+    std::string_view imageData; /** image data, blurhash etc.. */
+    std::string_view artist;    /** artist name. */
+    std::string_view album;     /** album title. */
+};
+
+/** \brief Data of the folders processed in the run by folder path. */
+using FolderIndex = std::unordered_map<std::string_view, FolderMetadata>;
+
+/** \struct FolderImage
+ * \brief Result of the computation of the image metadata of a folder.
+ *
+ */
+struct FolderImage
+{
+    bool        exists; /** true if the folder exists and has been processed. */
+    std::string data;   /** image data, blurhash etc.. or empty if no image. */
+    QString     error;  /** error message or empty if none. */
+
+    FolderImage()
+    : exists{false}
+    {};
 };
 
 /** \struct TrackOperationData
@@ -72,8 +153,8 @@ struct PlaylistImageOperationData
  */
 struct TrackNumberOperationData
 {
-    std::filesystem::path path;     /** path of track */
-    unsigned int          trackNum; /** track sequential number (takes into consideration multiple discs. */
+    ArenaPath    path;     /** path of track */
+    unsigned int trackNum; /** track sequential number (takes into consideration multiple discs. */
 };
 
 /** \struct PlaylistTracksOperationData
@@ -82,9 +163,35 @@ struct TrackNumberOperationData
  */
 struct PlaylistTracksOperationData
 {
-    std::filesystem::path path;             /** path of the playlist. */
-    std::set<std::filesystem::path> tracks; /** ordered mp3 tracks */
-    std::vector<std::string> track_ids;     /** ordered track ids in the database. */
+    ArenaPath                     path;      /** path of the playlist. */
+    std::vector<std::string_view> tracks;    /** ordered mp3 track names in the folder of the playlist. */
+    std::vector<std::string_view> track_ids; /** ordered track ids in the database. */
+};
+
+/** \struct OperationsChunk
+ * \brief Chunk of generated operations passed from the generators to the writer.
+ *
+ */
+struct OperationsChunk
+{
+    std::vector<PlaylistImageOperationData>  playlists;  /** playlist images metadata operations. */
+    std::vector<PlaylistTracksOperationData> tracklists; /** playlist tracklist operations. */
+    std::vector<TrackNumberOperationData>    tracks;     /** tracks number operations. */
+    std::vector<PlaylistImageOperationData>  albums;     /** albums metadata operations. */
+};
+
+using OperationsQueue = BoundedQueue<OperationsChunk>;
+
+/** \struct DatabaseItems
+ * \brief Contains the items to process, obtained in a single scan of the items table.
+ *
+ */
+struct DatabaseItems
+{
+    std::vector<ItemData> playlists;  /** playlists missing image, artist or album metadata. */
+    std::vector<ItemData> tracklists; /** playlists with an empty tracklist. */
+    std::vector<ItemData> tracks;     /** tracks missing the track number. */
+    std::vector<ItemData> albums;     /** albums missing image, artist or album metadata. */
 };
 
 /** \class ProcessThread
@@ -99,16 +206,16 @@ class ProcessThread
     /** \brief ProcessThread class constructor.
      * \param[in] db SQLite db handle.
      * \param[in] config ProcessConfiguration object with parameter values.
+     * \param[in] log Buffer of the log messages of the process.
      * \param[in] parent Raw pointer of the parent QObject.
      *
      */
-    explicit ProcessThread(sqlite3* db, const ProcessConfiguration config, QObject *parent = nullptr);
+    explicit ProcessThread(sqlite3* db, const ProcessConfiguration config, LogBuffer &log, QObject *parent = nullptr);
 
     /** \brief ProcessThread class virtual destructor.
      *
      */
-    virtual ~ProcessThread()
-    {}
+    virtual ~ProcessThread();
 
     /** \brief Aborts the thread if running
      *
@@ -134,51 +241,132 @@ class ProcessThread
     bool hasModifiedDB() const
     { return m_dbModified; }
 
-  signals:
-    void progress(int);
-    void message(const QString &);
+    /** \brief Returns the items found in the database.
+     *
+     */
+    const DatabaseItems &items() const
+    { return m_items; }
+
+    /** \brief Returns the phase durations, image timers and counters of the last run.
+     *
+     */
+    const Metrics &metrics() const
+    { return m_metrics; }
+
+    /** \brief Returns the number of finished operations. Can be called from any thread.
+     *
+     */
+    unsigned long operations() const
+    { return m_operations; }
+
+    /** \brief Returns the total number of operations, 0 if not yet known. Can be called from any thread.
+     *
+     */
+    unsigned long totalOperations() const
+    { return m_totalOperations; }
 
   protected:
     virtual void run();
 
   private:
-    /** \brief Counts the number of operations to perform in the database.
+    /** \brief Performs the process.
      *
      */
-    void countOperations();
+    void process();
 
-    /** \brief Performs a count operation in the database with the specified WHERE statement.
-     * \param[in] where_sql SQL statement starting with WHERE.
+    /** \brief Logs the metrics of the run and writes them to the metrics file if set.
      *
      */
-    unsigned long countSQLiteOperation(const std::string &where_sql);
+    void reportMetrics();
 
-    /** \brief Generate Playlist images operations data
+    /** \brief Opens the run state, if enabled, and computes the watermark of the current run.
      *
      */
-    std::vector<PlaylistImageOperationData> generatePlaylistImageOperations();
+    void openRunState();
 
-    /** \brief Generate Tracks operations data.
+    /** \brief Saves the run state, if enabled, after a finished run.
      *
      */
-    std::vector<TrackNumberOperationData> generateTracksNumberOperationData();
+    void saveRunState();
 
-    /** \brief Generate Albums operations data.
-     * \param[in] playlistOps Playlist images metadata operations to avoid recomputing the same data.
+    /** \brief Returns true if the item failed in the last run and neither the item nor its folder have changed.
+     * \param[in] kind Kind of operation of the item.
+     * \param[in] item Item data.
      *
      */
-    std::vector<PlaylistImageOperationData> generateAlbumsOperationsData(const std::vector<PlaylistImageOperationData> &playlistOps);
+    bool isKnownFailure(const std::string &kind, const ItemData &item);
 
-    /** \brief Generata Playlist tracks operations data.
+    /** \brief Stores the failure of an item in the run state, if enabled.
+     * \param[in] kind Kind of operation of the item.
+     * \param[in] path Item path.
+     * \param[in] folder Folder of the item files.
+     * \param[in] reason Failure description.
      *
      */
-    std::vector<PlaylistTracksOperationData> generatePlaylistTracksOperations();
+    void addFailure(const std::string &kind, const std::string &path, const std::filesystem::path &folder, const std::string &reason);
 
-    /** \brief Performs the playlist image update operations.
+    /** \brief Reads the items to process from the database in a single pass and counts the
+     * number of operations to perform.
+     *
+     */
+    void scanItems();
+
+    /** \brief Runs the generators in order and adds their operations to the queue in chunks, closing
+     * it at the end. Runs in the producer thread and doesn't use the database handle. Returns the
+     * duration of each generator.
+     * \param[in] queue Queue of the writer.
+     *
+     */
+    std::vector<PhaseTime> generateOperations(OperationsQueue &queue);
+
+    /** \brief Applies the chunks of operations of the queue as they are generated until the queue
+     * is closed and empty or the process is aborted, then closes the queue.
+     * \param[in] queue Queue of the generators.
+     *
+     */
+    void applyOperations(OperationsQueue &queue);
+
+    /** \brief Generate Playlist images operations data and adds their folders to the folders index.
+     * Returns false if the writer doesn't accept more operations.
+     * \param[in] queue Queue of the writer.
+     *
+     */
+    bool generatePlaylistImageOperations(OperationsQueue &queue);
+
+    /** \brief Generate Tracks operations data. Returns false if the writer doesn't accept more operations.
+     * \param[in] queue Queue of the writer.
+     *
+     */
+    bool generateTracksNumberOperationData(OperationsQueue &queue);
+
+    /** \brief Generate Albums operations data, reusing the data of the folders in the folders index to
+     * avoid recomputing it. Returns false if the writer doesn't accept more operations.
+     * \param[in] queue Queue of the writer.
+     *
+     */
+    bool generateAlbumsOperationsData(OperationsQueue &queue);
+
+    /** \brief Generata Playlist tracks operations data, the track ids are resolved by the writer.
+     * Returns false if the writer doesn't accept more operations.
+     * \param[in] queue Queue of the writer.
+     *
+     */
+    bool generatePlaylistTracksOperations(OperationsQueue &queue);
+
+    /** \brief Returns the ids of the tracks with the given paths, loading the paths in a temporary
+     * table and resolving all of them with a single query. Paths not in the database are not in the
+     * result. Returns false on error.
+     * \param[in] paths Track paths.
+     * \param[out] ids Track ids by path.
+     *
+     */
+    bool resolveTrackIds(const std::set<std::string> &paths, std::unordered_map<std::string, std::string> &ids);
+
+    /** \brief Performs the playlist image update operations. Returns the number of updated folders.
      * \param[in] operations List of playlist data operations to update.
      *
      */
-    void updatePlaylistImages(const std::vector<PlaylistImageOperationData> &operations);
+    unsigned long updatePlaylistImages(const std::vector<PlaylistImageOperationData> &operations);
 
     /** \brief Performs the tracks numbers operations.
      * \param[in] operations List of tracks data operations to update.
@@ -192,11 +380,24 @@ class ProcessThread
      */
     void updateAlbumOperations(const std::vector<PlaylistImageOperationData> & operations);
 
-    /** \brief Performs the playlist tracklist update operations.
+    /** \brief Resolves the track ids and performs the playlist tracklist update operations.
      * \param[in] operations List of playlist tracks data operations to update.
      *
      */
-    void updatePlaylistTracks(const std::vector<PlaylistTracksOperationData> & operations);
+    void updatePlaylistTracks(std::vector<PlaylistTracksOperationData> &operations);
+
+    /** \brief Stores the duration of a phase and restarts the timer.
+     * \param[in] name Phase name.
+     * \param[in] timer Timer started at the beginning of the phase.
+     *
+     */
+    void phaseFinished(const std::string &name, QElapsedTimer &timer);
+
+    /** \brief Adds the message to the log buffer, never blocks.
+     * \param[in] message Message text.
+     *
+     */
+    void log(const QString &message);
 
     /** \brief Helper method to check for SQLite execution errors and clean up
      * a little the code. Returns true on success and false on fail (code != expected).
@@ -207,10 +408,80 @@ class ProcessThread
      */
     bool checkSQLiteError(int code, int expectedCode, int line);
 
-    /** \brief Helper method to check the progress value and sends a progress signal.
+    /** \brief Helper method to step a statement counting the steps. Returns the result of sqlite3_step().
+     * \param[in] statement SQLite statement.
      *
      */
-    void checkProgress(const unsigned long opNumber);
+    int step(sqlite3_stmt *statement);
+
+    /** \brief Returns the artist, album and image columns modified by the playlist and album updates.
+     *
+     */
+    std::vector<ColumnAssignment> metadataColumns() const;
+
+    /** \brief Returns the SQL of an update of the given columns of the items that match the condition.
+     * In a dry run returns a query of the row id and the current and new value of each column instead.
+     * \param[in] columns Modified columns.
+     * \param[in] condition Condition of the modified items.
+     *
+     */
+    std::string updateSql(const std::vector<ColumnAssignment> &columns, const std::string &condition) const;
+
+    /** \brief Helper method to execute a statement built with updateSql(). In a dry run writes the changes
+     * to the plan file. Returns the result of the last step.
+     * \param[in] statement SQLite statement.
+     *
+     */
+    int applyUpdate(sqlite3_stmt *statement);
+
+    /** \brief Creates an index on the Path column of the items table if the database has none, to
+     * update the tracks of the playlists without scanning the table.
+     *
+     */
+    void createPathIndex();
+
+    /** \brief Removes the index on the Path column left in the database by an aborted or crashed
+     * run, so it isn't taken as an index of the database.
+     *
+     */
+    void dropStalePathIndex();
+
+    /** \brief Removes the index on the Path column if it was created by createPathIndex().
+     *
+     */
+    void dropPathIndex();
+
+    /** \brief Helper method to open a transaction before an update operation. Returns
+     * true on success and false otherwise.
+     *
+     */
+    bool beginWrite();
+
+    /** \brief Helper method to account an update operation in the current transaction and
+     * report the batch information if the transaction has been committed.
+     * \param[in] bytes Approximate size of the data written in the operation.
+     *
+     */
+    void endWrite(unsigned long bytes);
+
+    /** \brief Commits the pending update operations and reports the batches information.
+     *
+     */
+    void finishWrites();
+
+    /** \brief Appends the changes of the current transaction to the changes journal, if enabled.
+     * Called before each commit, on error the transaction is rolled back. Returns true on success
+     * and false otherwise.
+     * \param[out] error Error message.
+     *
+     */
+    bool saveJournal(QString &error);
+
+    /** \brief Writes the changes journal with the previous values of the modified rows, if enabled,
+     * and stops recording.
+     *
+     */
+    void writeJournal();
 
     /** \brief Helper method that parses the given text and returns the artist and album
      * text as strings. In the pair the first is artist, second is album.
@@ -220,17 +491,41 @@ class ProcessThread
     std::pair<std::string, std::string> artistAndAlbumMetadata(const std::wstring &text) const;
 
     /** \brief Helper method to read the image file in the given path and returns the computed
-     * blurhash string.
+     * blurhash string. Can be called concurrently from the worker threads.
      * \param[in] path Folder contaning the audio and image files.
+     * \param[out] error Error message or empty if none.
      *
      */
-    std::string albumBlurhash(const std::filesystem::path &path);
+    std::string albumBlurhash(const std::filesystem::path &path, QString &error) const;
 
-    sqlite3             *m_sql3Handle; /** SQLite db handle */
-    ProcessConfiguration m_config;     /** process parameters. */
-    QString              m_error;      /** error message or empty if none. */
-    bool                 m_abort;      /** true to stop the process. */
-    bool                 m_dbModified; /** true if database was modified and false otherwise. */
+    /** \brief Helper method that computes the image metadata of the given folder, catching any
+     * exception. Can be called concurrently from the worker threads.
+     * \param[in] path Folder contaning the audio and image files.
+     *
+     */
+    FolderImage folderImage(const std::filesystem::path &path) const;
+
+    sqlite3                        *m_sql3Handle;       /** SQLite db handle */
+    LogBuffer                      &m_log;              /** log messages buffer. */
+    ProcessConfiguration            m_config;           /** process parameters. */
+    QString                         m_error;            /** error message or empty if none. */
+    std::atomic<bool>               m_abort;            /** true to stop the process. */
+    bool                            m_dbModified;       /** true if database was modified and false otherwise. */
+    bool                            m_pathIndexCreated; /** true if the index on Path was created by the process. */
+    std::atomic<unsigned long>      m_operations;       /** number of finished operations. */
+    std::atomic<unsigned long>      m_totalOperations;  /** total number of operations. */
+    std::unique_ptr<BatchWriter>    m_writer;           /** groups the update operations in transactions. */
+    std::unique_ptr<PlanWriter>     m_plan;             /** planned changes file in a dry run. */
+    std::unique_ptr<ChangeJournal>  m_journal;          /** records the previous values of the modified rows. */
+    std::unique_ptr<RunState>       m_state;            /** state of the last run or nullptr to process all the items. */
+    std::string                     m_watermark;        /** greatest creation or modification date of the items of the run. */
+    DatabaseItems                   m_items;            /** items to process. */
+    std::unique_ptr<ThreadPool>     m_pool;             /** worker threads to compute the images. */
+    std::unique_ptr<BlurhashCache>  m_cache;            /** computed blurhashes of previous runs. */
+    mutable Metrics                 m_metrics;          /** phase durations, image timers and counters of the last run. */
+    mutable DirectoryCache          m_directories;      /** folder listings shared by all the generators. */
+    StringArena                     m_arena;            /** paths and texts of the operations of the run. */
+    FolderIndex                     m_folders;          /** data of the processed folders, only used by the generators. */
 };
 
 #endif // PROCESSTHREAD_H_
@@ -0,0 +1,97 @@
+/*
+ File: ProgressEstimator.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <ProgressEstimator.h>
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#endif
+
+//---------------------------------------------------------------
+ProgressEstimator::ProgressEstimator(double window)
+: m_window{window}
+{
+}
+
+//---------------------------------------------------------------
+void ProgressEstimator::reset()
+{
+  m_samples.clear();
+}
+
+//---------------------------------------------------------------
+void ProgressEstimator::addSample(double seconds, unsigned long operations)
+{
+  m_samples.emplace_back(seconds, operations);
+
+  // Keep at least two samples to compute a rate.
+  while(m_samples.size() > 2 && seconds - m_samples[1].first >= m_window)
+    m_samples.pop_front();
+}
+
+//---------------------------------------------------------------
+double ProgressEstimator::rate() const
+{
+  if(m_samples.size() < 2) return 0;
+
+  const auto &first = m_samples.front();
+  const auto &last = m_samples.back();
+  if(last.first <= first.first || last.second < first.second) return 0;
+
+  return (last.second - first.second) / (last.first - first.first);
+}
+
+//---------------------------------------------------------------
+double ProgressEstimator::remaining(unsigned long total) const
+{
+  const auto operationsRate = rate();
+  if(operationsRate <= 0) return -1;
+
+  const auto done = m_samples.back().second;
+  return done >= total ? 0 : (total - done) / operationsRate;
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+TEST_CASE("progress estimator")
+{
+  ProgressEstimator estimator(1.0);
+  CHECK(estimator.rate() == 0);
+  CHECK(estimator.remaining(100) < 0);
+
+  // 8 operations per second for 2 seconds, then 32 per second.
+  for(int i = 0; i <= 16; ++i)
+    estimator.addSample(i * 0.125, i);
+  CHECK(estimator.rate() == doctest::Approx(8.0));
+  CHECK(estimator.remaining(96) == doctest::Approx(10.0));
+
+  for(int i = 1; i <= 16; ++i)
+    estimator.addSample(2 + i * 0.125, 16 + 4 * i);
+  CHECK(estimator.rate() == doctest::Approx(32.0));
+  CHECK(estimator.remaining(112) == doctest::Approx(1.0));
+  CHECK(estimator.remaining(80) == doctest::Approx(0.0));
+
+  estimator.reset();
+  CHECK(estimator.rate() == 0);
+}
+#endif
@@ -0,0 +1,71 @@
+/*
+ File: ProgressEstimator.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROGRESSESTIMATOR_H_
+#define PROGRESSESTIMATOR_H_
+
+// C++
+#include <deque>
+#include <utility>
+
+/** \class ProgressEstimator
+ * \brief Computes the operations rate and the remaining time from periodic samples of an
+ * operations counter, using the samples of the last seconds.
+ *
+ */
+class ProgressEstimator
+{
+  public:
+    /** \brief ProgressEstimator class constructor.
+     * \param[in] window Time in seconds of the samples used to compute the rate.
+     *
+     */
+    explicit ProgressEstimator(double window = 3.0);
+
+    /** \brief Removes all the samples.
+     *
+     */
+    void reset();
+
+    /** \brief Adds a sample.
+     * \param[in] seconds Time of the sample in seconds.
+     * \param[in] operations Number of finished operations at that time.
+     *
+     */
+    void addSample(double seconds, unsigned long operations);
+
+    /** \brief Returns the number of operations per second or 0 if unknown.
+     *
+     */
+    double rate() const;
+
+    /** \brief Returns the estimated remaining time in seconds or a negative value if unknown.
+     * \param[in] total Total number of operations.
+     *
+     */
+    double remaining(unsigned long total) const;
+
+  private:
+    using Sample = std::pair<double, unsigned long>;
+
+    double             m_window;  /** time in seconds of the samples used. */
+    std::deque<Sample> m_samples; /** time and operations samples. */
+};
+
+#endif // PROGRESSESTIMATOR_H_
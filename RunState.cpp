@@ -0,0 +1,269 @@
+/*
+ File: RunState.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <RunState.h>
+
+// SQLite
+#include <sqlite3/sqlite3.h>
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#endif
+
+const char *const CREATE_STATE_SQL = "CREATE TABLE IF NOT EXISTS State (Key TEXT PRIMARY KEY NOT NULL, Value TEXT NOT NULL) WITHOUT ROWID;"
+                                     "CREATE TABLE IF NOT EXISTS Failures (Kind TEXT NOT NULL, Path TEXT NOT NULL, Folder TEXT NOT NULL, "
+                                     "WriteTime INTEGER NOT NULL, Reason TEXT NOT NULL, PRIMARY KEY (Kind, Path)) WITHOUT ROWID";
+
+//---------------------------------------------------------------
+static std::string failureKey(const std::string &kind, const std::string &path)
+{
+  return kind + '\n' + path;
+}
+
+//---------------------------------------------------------------
+RunState::RunState(const std::filesystem::path &file)
+: m_db{nullptr}
+{
+  // SQLite expects UTF-8 file names, std::string uses the ANSI code page on Windows(tm).
+  if(sqlite3_open(QString::fromStdWString(file.wstring()).toUtf8().constData(), &m_db) != SQLITE_OK)
+  {
+    m_error = QString("Unable to open run state '%1'. SQLite3 error: %2").arg(QString::fromStdWString(file.wstring()))
+                .arg(QString::fromLatin1(sqlite3_errmsg(m_db)));
+    return;
+  }
+
+  if(execute(CREATE_STATE_SQL)) load();
+}
+
+//---------------------------------------------------------------
+RunState::~RunState()
+{
+  if(m_db) sqlite3_close(m_db);
+}
+
+//---------------------------------------------------------------
+bool RunState::execute(const std::string &sql)
+{
+  const auto result = sqlite3_exec(m_db, sql.c_str(), nullptr, nullptr, nullptr);
+  if(result != SQLITE_OK)
+    m_error = QString("Unable to update run state. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errmsg(m_db)));
+
+  return result == SQLITE_OK;
+}
+
+//---------------------------------------------------------------
+bool RunState::load()
+{
+  auto text = [](sqlite3_stmt *statement, int idx)
+  {
+    const auto value = reinterpret_cast<const char *>(sqlite3_column_text(statement, idx));
+    return value ? std::string(value, sqlite3_column_bytes(statement, idx)) : std::string();
+  };
+
+  sqlite3_stmt *statement = nullptr;
+  auto result = sqlite3_prepare_v2(m_db, "SELECT Key, Value FROM State", -1, &statement, nullptr);
+  if(result == SQLITE_OK) result = sqlite3_step(statement);
+  for(; result == SQLITE_ROW; result = sqlite3_step(statement))
+  {
+    const auto key = text(statement, 0);
+    if(key == "LastRun")            m_lastRun = text(statement, 1);
+    else if(key == "Watermark")     m_watermark = text(statement, 1);
+    else if(key == "Configuration") m_configuration = text(statement, 1);
+  }
+  sqlite3_finalize(statement);
+
+  if(result == SQLITE_DONE)
+  {
+    result = sqlite3_prepare_v2(m_db, "SELECT Kind, Path, Folder, WriteTime, Reason FROM Failures", -1, &statement, nullptr);
+    if(result == SQLITE_OK) result = sqlite3_step(statement);
+    for(; result == SQLITE_ROW; result = sqlite3_step(statement))
+    {
+      ItemFailure failure;
+      failure.folder = text(statement, 2);
+      failure.writeTime = sqlite3_column_int64(statement, 3);
+      failure.reason = text(statement, 4);
+
+      m_previous.emplace(failureKey(text(statement, 0), text(statement, 1)), failure);
+    }
+    sqlite3_finalize(statement);
+  }
+
+  if(result != SQLITE_DONE)
+  {
+    m_error = QString("Unable to read run state. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errmsg(m_db)));
+    return false;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------
+void RunState::clear()
+{
+  m_lastRun.clear();
+  m_watermark.clear();
+  m_configuration.clear();
+  m_previous.clear();
+}
+
+//---------------------------------------------------------------
+bool RunState::isKnownFailure(const std::string &kind, const std::string &path)
+{
+  const auto key = failureKey(kind, path);
+
+  const auto it = m_previous.find(key);
+  if(it == m_previous.cend()) return false;
+
+  if(writeTime(std::filesystem::path(QString::fromStdString(it->second.folder).toStdWString())) != it->second.writeTime) return false;
+
+  m_current[key] = it->second;
+  return true;
+}
+
+//---------------------------------------------------------------
+void RunState::addFailure(const std::string &kind, const std::string &path, const std::filesystem::path &folder, const std::string &reason)
+{
+  ItemFailure failure;
+  failure.folder = QString::fromStdWString(folder.wstring()).toStdString();
+  failure.writeTime = writeTime(folder);
+  failure.reason = reason;
+
+  m_current[failureKey(kind, path)] = failure;
+}
+
+//---------------------------------------------------------------
+bool RunState::save(const std::string &lastRun, const std::string &watermark, const std::string &configuration)
+{
+  if(!m_db || !execute("BEGIN TRANSACTION")) return false;
+
+  bool ok = execute("DELETE FROM Failures");
+
+  sqlite3_stmt *statement = nullptr;
+  if(ok && sqlite3_prepare_v2(m_db, "INSERT INTO Failures VALUES (?1, ?2, ?3, ?4, ?5)", -1, &statement, nullptr) == SQLITE_OK)
+  {
+    for(auto it = m_current.cbegin(); ok && it != m_current.cend(); ++it)
+    {
+      const auto separator = it->first.find('\n');
+      sqlite3_bind_text(statement, 1, it->first.c_str(), separator, SQLITE_TRANSIENT);
+      sqlite3_bind_text(statement, 2, it->first.c_str() + separator + 1, -1, SQLITE_TRANSIENT);
+      sqlite3_bind_text(statement, 3, it->second.folder.c_str(), -1, SQLITE_TRANSIENT);
+      sqlite3_bind_int64(statement, 4, it->second.writeTime);
+      sqlite3_bind_text(statement, 5, it->second.reason.c_str(), -1, SQLITE_TRANSIENT);
+      ok = sqlite3_step(statement) == SQLITE_DONE;
+      sqlite3_reset(statement);
+    }
+  }
+  else
+  {
+    ok = false;
+  }
+  sqlite3_finalize(statement);
+
+  if(ok && sqlite3_prepare_v2(m_db, "INSERT OR REPLACE INTO State VALUES (?1, ?2)", -1, &statement, nullptr) == SQLITE_OK)
+  {
+    const std::pair<const char *, std::string> values[] = { {"LastRun", lastRun}, {"Watermark", watermark}, {"Configuration", configuration} };
+    for(const auto &value: values)
+    {
+      sqlite3_bind_text(statement, 1, value.first, -1, SQLITE_STATIC);
+      sqlite3_bind_text(statement, 2, value.second.c_str(), -1, SQLITE_TRANSIENT);
+      ok = ok && sqlite3_step(statement) == SQLITE_DONE;
+      sqlite3_reset(statement);
+    }
+  }
+  else
+  {
+    ok = false;
+  }
+  sqlite3_finalize(statement);
+
+  if(!ok)
+  {
+    m_error = QString("Unable to write run state. SQLite3 error: %1").arg(QString::fromLatin1(sqlite3_errmsg(m_db)));
+    execute("ROLLBACK");
+    return false;
+  }
+
+  if(!execute("COMMIT")) return false;
+
+  m_lastRun = lastRun;
+  m_watermark = watermark;
+  m_configuration = configuration;
+  m_previous = m_current;
+
+  return true;
+}
+
+//---------------------------------------------------------------
+long long RunState::writeTime(const std::filesystem::path &folder)
+{
+  std::error_code error;
+  const auto time = std::filesystem::last_write_time(folder, error);
+
+  return error ? -1 : static_cast<long long>(time.time_since_epoch().count());
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+TEST_CASE("run state")
+{
+  const auto folder = std::filesystem::temp_directory_path() / "RunStateTest";
+  std::filesystem::remove_all(folder);
+  std::filesystem::create_directories(folder / "Album");
+
+  const auto file = folder / "state.db";
+  const auto path = (folder / "Album" / "Album.m3u").string();
+
+  {
+    RunState state(file);
+    REQUIRE(state.isValid());
+    CHECK(state.watermark().empty());
+    CHECK_FALSE(state.isKnownFailure("playlist", path));
+
+    state.addFailure("playlist", path, folder / "Album", "No image");
+    state.addFailure("track", path, folder / "Missing", "Doesn't exist");
+    CHECK(state.failures() == 2);
+    CHECK(state.save("2026-10-15T10:00:00", "2026-10-15 09:00:00", "abc"));
+  }
+
+  {
+    RunState state(file);
+    REQUIRE(state.isValid());
+    CHECK(state.lastRun() == "2026-10-15T10:00:00");
+    CHECK(state.watermark() == "2026-10-15 09:00:00");
+    CHECK(state.configuration() == "abc");
+    CHECK(state.isKnownFailure("playlist", path));
+    CHECK(state.isKnownFailure("track", path));
+    CHECK_FALSE(state.isKnownFailure("album", path));
+    CHECK(state.failures() == 2);
+
+    // A new folder changes the write time of the parent.
+    std::filesystem::create_directories(folder / "Missing");
+    CHECK_FALSE(state.isKnownFailure("track", path));
+
+    state.clear();
+    CHECK_FALSE(state.isKnownFailure("playlist", path));
+  }
+
+  std::filesystem::remove_all(folder);
+}
+#endif
@@ -0,0 +1,164 @@
+/*
+ File: RunState.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNSTATE_H_
+#define RUNSTATE_H_
+
+// Qt
+#include <QString>
+
+// C++
+#include <filesystem>
+#include <map>
+#include <string>
+
+struct sqlite3;
+
+/** \struct ItemFailure
+ * \brief Fingerprint of an item that couldn't be completed: the folder that contains its files
+ * and the last write time of the folder when it failed.
+ *
+ */
+struct ItemFailure
+{
+    std::string folder;    /** folder of the item files, UTF-8 encoded. */
+    long long   writeTime; /** last write time of the folder, -1 if it didn't exist. */
+    std::string reason;    /** failure description. */
+
+    ItemFailure()
+    : writeTime{-1}
+    {};
+};
+
+/** \class RunState
+ * \brief State of the last finished run in a SQLite file: time of the run, items table watermark,
+ * fingerprint of the configuration and the items that failed. Failures of the previous run are
+ * kept while their folders don't change, the rest are replaced with the ones of the current run
+ * when the state is saved.
+ *
+ */
+class RunState
+{
+  public:
+    /** \brief RunState class constructor. Opens or creates the state file and loads the last state.
+     * \param[in] file State file path.
+     *
+     */
+    explicit RunState(const std::filesystem::path &file);
+
+    /** \brief RunState class destructor.
+     *
+     */
+    ~RunState();
+
+    /** \brief Returns true if the state file could be opened and read.
+     *
+     */
+    bool isValid() const
+    { return m_db && m_error.isEmpty(); }
+
+    /** \brief Returns the error message or empty if none.
+     *
+     */
+    QString error() const
+    { return m_error; }
+
+    /** \brief Returns the time of the last finished run or empty if none.
+     *
+     */
+    const std::string &lastRun() const
+    { return m_lastRun; }
+
+    /** \brief Returns the greatest creation or modification date of the items in the last run,
+     * or empty if none.
+     *
+     */
+    const std::string &watermark() const
+    { return m_watermark; }
+
+    /** \brief Returns the configuration fingerprint of the last run or empty if none.
+     *
+     */
+    const std::string &configuration() const
+    { return m_configuration; }
+
+    /** \brief Forgets the last run, all the items will be processed.
+     *
+     */
+    void clear();
+
+    /** \brief Returns true if the item failed in the last run and its folder hasn't changed since.
+     * The failure is kept for the next run.
+     * \param[in] kind Kind of operation of the item.
+     * \param[in] path Item path.
+     *
+     */
+    bool isKnownFailure(const std::string &kind, const std::string &path);
+
+    /** \brief Stores a failure of the current run.
+     * \param[in] kind Kind of operation of the item.
+     * \param[in] path Item path.
+     * \param[in] folder Folder of the item files.
+     * \param[in] reason Failure description.
+     *
+     */
+    void addFailure(const std::string &kind, const std::string &path, const std::filesystem::path &folder, const std::string &reason);
+
+    /** \brief Returns the number of failures of the current run, including the known ones.
+     *
+     */
+    size_t failures() const
+    { return m_current.size(); }
+
+    /** \brief Writes the state of the current run. Returns true on success and false otherwise.
+     * \param[in] lastRun Time of the run.
+     * \param[in] watermark Greatest creation or modification date of the items.
+     * \param[in] configuration Configuration fingerprint.
+     *
+     */
+    bool save(const std::string &lastRun, const std::string &watermark, const std::string &configuration);
+
+    /** \brief Returns the last write time of the folder or -1 if it doesn't exist.
+     * \param[in] folder Folder path.
+     *
+     */
+    static long long writeTime(const std::filesystem::path &folder);
+
+  private:
+    /** \brief Executes the SQL. Returns true on success and false otherwise.
+     * \param[in] sql SQL text.
+     *
+     */
+    bool execute(const std::string &sql);
+
+    /** \brief Loads the state of the last run. Returns true on success and false otherwise.
+     *
+     */
+    bool load();
+
+    sqlite3                            *m_db;            /** state database. */
+    QString                             m_error;         /** error message or empty if none. */
+    std::string                         m_lastRun;       /** time of the last run. */
+    std::string                         m_watermark;     /** items watermark of the last run. */
+    std::string                         m_configuration; /** configuration fingerprint of the last run. */
+    std::map<std::string, ItemFailure>  m_previous;      /** failures of the last run by kind and path. */
+    std::map<std::string, ItemFailure>  m_current;       /** failures of the current run by kind and path. */
+};
+
+#endif // RUNSTATE_H_
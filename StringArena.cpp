@@ -0,0 +1,189 @@
+/*
+ File: StringArena.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <StringArena.h>
+
+// C++
+#include <cstring>
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#endif
+
+// Separators of the item paths, Windows(tm) accepts both.
+#ifdef _WIN32
+const char *const PATH_SEPARATORS = "\\/";
+#else
+const char *const PATH_SEPARATORS = "/";
+#endif
+
+//---------------------------------------------------------------
+StringArena::StringArena(size_t blockSize)
+: m_blockSize{blockSize}
+, m_used{0}
+, m_available{0}
+, m_stats{0, 0, 0, 0, 0}
+{
+}
+
+//---------------------------------------------------------------
+std::string_view StringArena::store(std::string_view text)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  return copy(text);
+}
+
+//---------------------------------------------------------------
+std::string_view StringArena::intern(std::string_view text)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const auto it = m_interned.find(text);
+  if(it != m_interned.cend())
+  {
+    ++m_stats.shared;
+    return *it;
+  }
+
+  const auto stored = copy(text);
+  m_interned.insert(stored);
+
+  return stored;
+}
+
+//---------------------------------------------------------------
+ArenaPath StringArena::path(std::string_view path)
+{
+  const auto position = path.find_last_of(PATH_SEPARATORS);
+  if(position == std::string_view::npos) return ArenaPath{std::string_view(), store(path)};
+
+  return ArenaPath{intern(path.substr(0, position + 1)), store(path.substr(position + 1))};
+}
+
+//---------------------------------------------------------------
+void StringArena::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_interned.clear();
+  m_blocks.clear();
+  m_used = m_available = 0;
+  m_stats = ArenaStatistics{0, 0, 0, 0, 0};
+}
+
+//---------------------------------------------------------------
+ArenaStatistics StringArena::statistics() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  return m_stats;
+}
+
+//---------------------------------------------------------------
+std::string_view StringArena::copy(std::string_view text)
+{
+  ++m_stats.strings;
+  m_stats.bytes += text.size();
+
+  if(text.empty()) return std::string_view();
+
+  // Big strings get a block of their own before the current one so its free space is not lost.
+  if(text.size() > m_blockSize)
+  {
+    auto block = std::make_unique<char[]>(text.size());
+    std::memcpy(block.get(), text.data(), text.size());
+    const std::string_view stored(block.get(), text.size());
+
+    m_blocks.insert(m_blocks.empty() ? m_blocks.end() : m_blocks.end() - 1, std::move(block));
+    m_stats.reserved += text.size();
+    ++m_stats.blocks;
+
+    return stored;
+  }
+
+  if(text.size() > m_available)
+  {
+    m_blocks.push_back(std::make_unique<char[]>(m_blockSize));
+    m_used = 0;
+    m_available = m_blockSize;
+    m_stats.reserved += m_blockSize;
+    ++m_stats.blocks;
+  }
+
+  char *destination = m_blocks.back().get() + m_used;
+  std::memcpy(destination, text.data(), text.size());
+  m_used += text.size();
+  m_available -= text.size();
+
+  return std::string_view(destination, text.size());
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+TEST_CASE("string arena")
+{
+  StringArena arena(16);
+
+  const auto first = arena.intern("Artist");
+  const auto second = arena.intern(std::string("Artist"));
+  CHECK(first == "Artist");
+  CHECK(first.data() == second.data());
+  CHECK(arena.store("Artist").data() != first.data());
+
+  // Bigger than a block, the current block is still used.
+  const std::string big(40, 'x');
+  CHECK(arena.store(big) == big);
+  const auto small = arena.store("abc");
+  CHECK(small.data() == first.data() + 12);
+
+  const auto stats = arena.statistics();
+  CHECK(stats.strings == 4);
+  CHECK(stats.shared == 1);
+  CHECK(stats.bytes == 6 * 2 + 40 + 3);
+  CHECK(stats.blocks == 2);
+  CHECK(stats.reserved == 16 + 40);
+
+  arena.clear();
+  CHECK(arena.statistics().strings == 0);
+  CHECK(arena.statistics().blocks == 0);
+}
+
+TEST_CASE("arena paths")
+{
+  StringArena arena;
+
+  const auto track1 = arena.path("/music/Artist - Album/01 - One.mp3");
+  const auto track2 = arena.path("/music/Artist - Album/02 - Two.mp3");
+  CHECK(track1.folder == "/music/Artist - Album/");
+  CHECK(track1.folder.data() == track2.folder.data());
+  CHECK(track2.name == "02 - Two.mp3");
+  CHECK(track2.string() == "/music/Artist - Album/02 - Two.mp3");
+  CHECK(track1.parent() == "/music/Artist - Album");
+
+  const auto relative = arena.path("file.mp3");
+  CHECK(relative.folder.empty());
+  CHECK(relative.parent().empty());
+  CHECK(relative.string() == "file.mp3");
+}
+#endif
@@ -0,0 +1,132 @@
+/*
+ File: StringArena.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STRINGARENA_H_
+#define STRINGARENA_H_
+
+// C++
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+/** \struct ArenaPath
+ * \brief Path stored in an arena as its folder, shared by all the paths in the same folder,
+ * and its name.
+ *
+ */
+struct ArenaPath
+{
+    std::string_view folder; /** folder path including the last separator or empty if none. */
+    std::string_view name;   /** file or folder name. */
+
+    /** \brief Returns the complete path text.
+     *
+     */
+    std::string string() const
+    { return std::string(folder).append(name); }
+
+    /** \brief Returns the complete path.
+     *
+     */
+    std::filesystem::path path() const
+    { return std::filesystem::path(string()); }
+
+    /** \brief Returns the folder path without the last separator.
+     *
+     */
+    std::string_view parent() const
+    { return folder.empty() ? folder : folder.substr(0, folder.size() - 1); }
+};
+
+/** \struct ArenaStatistics
+ * \brief Memory used by an arena.
+ *
+ */
+struct ArenaStatistics
+{
+    size_t strings;  /** number of stored strings. */
+    size_t shared;   /** number of interned strings that were already stored. */
+    size_t bytes;    /** bytes used by the strings. */
+    size_t reserved; /** bytes allocated in blocks. */
+    size_t blocks;   /** number of allocated blocks. */
+};
+
+/** \class StringArena
+ * \brief Stores the strings of a run in big blocks that are released together. The returned views
+ * are valid until the arena is cleared or destroyed. Can be used concurrently from several threads.
+ *
+ */
+class StringArena
+{
+  public:
+    /** \brief StringArena class constructor.
+     * \param[in] blockSize Size in bytes of the blocks, bigger strings get a block of their own.
+     *
+     */
+    explicit StringArena(size_t blockSize = 64*1024);
+
+    /** \brief Copies the text to the arena and returns the copy.
+     * \param[in] text Text to store.
+     *
+     */
+    std::string_view store(std::string_view text);
+
+    /** \brief Returns the copy of the text in the arena, storing it only if it's not already interned.
+     * \param[in] text Text to intern.
+     *
+     */
+    std::string_view intern(std::string_view text);
+
+    /** \brief Stores the path with its folder interned and its name copied.
+     * \param[in] path Path text.
+     *
+     */
+    ArenaPath path(std::string_view path);
+
+    /** \brief Releases all the strings.
+     *
+     */
+    void clear();
+
+    /** \brief Returns the memory used by the arena.
+     *
+     */
+    ArenaStatistics statistics() const;
+
+  private:
+    /** \brief Copies the text to the current block, allocating a new one if needed. Must be called with the mutex locked.
+     * \param[in] text Text to store.
+     *
+     */
+    std::string_view copy(std::string_view text);
+
+    const size_t                         m_blockSize; /** size of the blocks. */
+    std::vector<std::unique_ptr<char[]>> m_blocks;    /** allocated blocks. */
+    size_t                               m_used;      /** bytes used in the last block. */
+    size_t                               m_available; /** bytes available in the last block. */
+    std::unordered_set<std::string_view> m_interned;  /** interned strings. */
+    ArenaStatistics                      m_stats;     /** memory used. */
+    mutable std::mutex                   m_mutex;     /** protects the arena data. */
+};
+
+#endif // STRINGARENA_H_
@@ -0,0 +1,145 @@
+/*
+ File: ThreadPool.cpp
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Project
+#include <ThreadPool.h>
+
+// C++
+#include <algorithm>
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#if __has_include(<doctest.h>)
+#include <doctest.h>
+#else
+#include <doctest/doctest.h>
+#endif
+#include <stdexcept>
+#endif
+
+//---------------------------------------------------------------
+ThreadPool::ThreadPool(unsigned int threads)
+: m_task{nullptr}
+, m_count{0}
+, m_next{0}
+, m_active{0}
+, m_generation{0}
+, m_stop{false}
+{
+  if(threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+  for(unsigned int i = 0; i < threads; ++i)
+    m_threads.emplace_back(&ThreadPool::work, this);
+}
+
+//---------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_jobReady.notify_all();
+
+  for(auto &thread: m_threads)
+    thread.join();
+}
+
+//---------------------------------------------------------------
+void ThreadPool::run(size_t count, const std::function<void(size_t)> &task)
+{
+  if(count == 0) return;
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_task = &task;
+  m_count = count;
+  m_next = 0;
+  m_active = size();
+  ++m_generation;
+  m_jobReady.notify_all();
+
+  m_jobDone.wait(lock, [this](){ return m_active == 0; });
+  m_task = nullptr;
+
+  if(m_exception)
+  {
+    auto exception = m_exception;
+    m_exception = nullptr;
+    std::rethrow_exception(exception);
+  }
+}
+
+//---------------------------------------------------------------
+void ThreadPool::work()
+{
+  unsigned long generation = 0;
+
+  while(true)
+  {
+    const std::function<void(size_t)> *task = nullptr;
+    size_t count = 0;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_jobReady.wait(lock, [this, generation](){ return m_stop || m_generation != generation; });
+      if(m_stop) return;
+
+      generation = m_generation;
+      task = m_task;
+      count = m_count;
+    }
+
+    for(size_t i = m_next++; i < count; i = m_next++)
+    {
+      try
+      {
+        (*task)(i);
+      }
+      catch(...)
+      {
+        // The job is finished, the exception is passed to the caller.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(!m_exception) m_exception = std::current_exception();
+        m_next = count;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if(--m_active == 0) m_jobDone.notify_one();
+    }
+  }
+}
+
+#ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+TEST_CASE("thread pool")
+{
+  ThreadPool pool(4);
+  CHECK(pool.size() == 4);
+
+  std::vector<int> values(1000, 0);
+  pool.run(values.size(), [&values](size_t i){ values[i] = static_cast<int>(i); });
+  for(size_t i = 0; i < values.size(); ++i) CHECK(values[i] == static_cast<int>(i));
+
+  // The exception is thrown in the caller and the pool is still usable.
+  CHECK_THROWS_AS(pool.run(values.size(), [](size_t i){ if(i == 10) throw std::runtime_error("task"); }), std::runtime_error);
+
+  std::atomic<size_t> executed{0};
+  pool.run(values.size(), [&executed](size_t){ ++executed; });
+  CHECK(executed == values.size());
+}
+#endif
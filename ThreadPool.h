@@ -0,0 +1,85 @@
+/*
+ File: ThreadPool.h
+ Created on: 15/10/2026
+ Author: Felix de las Pozas Alvarez
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+// C++
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** \class ThreadPool
+ * \brief Fixed number of worker threads that execute an indexed task over a range of indexes.
+ *
+ */
+class ThreadPool
+{
+  public:
+    /** \brief ThreadPool class constructor.
+     * \param[in] threads Number of worker threads, hardware concurrency if 0.
+     *
+     */
+    explicit ThreadPool(unsigned int threads);
+
+    /** \brief ThreadPool class destructor. Stops and joins the worker threads.
+     *
+     */
+    ~ThreadPool();
+
+    /** \brief Returns the number of worker threads.
+     *
+     */
+    unsigned int size() const
+    { return static_cast<unsigned int>(m_threads.size()); }
+
+    /** \brief Executes the task for every index in [0, count) in the worker threads and
+     * returns when all of them have finished. Tasks with different indexes can run
+     * concurrently, so the task must only write to data owned by its index. If a task throws
+     * the remaining indexes are not executed and the first exception is rethrown in the caller.
+     * \param[in] count Number of indexes.
+     * \param[in] task Task to execute.
+     *
+     */
+    void run(size_t count, const std::function<void(size_t)> &task);
+
+  private:
+    /** \brief Worker threads main loop.
+     *
+     */
+    void work();
+
+    std::vector<std::thread>          m_threads;    /** worker threads. */
+    std::mutex                        m_mutex;      /** protects the job data. */
+    std::condition_variable           m_jobReady;   /** signals a new job or stop to the workers. */
+    std::condition_variable           m_jobDone;    /** signals the end of the job to the caller. */
+    const std::function<void(size_t)> *m_task;      /** task of the current job. */
+    size_t                            m_count;      /** number of indexes of the current job. */
+    std::atomic<size_t>               m_next;       /** next index to execute. */
+    unsigned int                      m_active;     /** number of workers still in the current job. */
+    unsigned long                     m_generation; /** job number, to detect new jobs. */
+    std::exception_ptr                m_exception;  /** first exception thrown by a task of the current job. */
+    bool                              m_stop;       /** true to stop the workers. */
+};
+
+#endif // THREADPOOL_H_
@@ -7,12 +7,23 @@
 #include <numbers>
 #include <stdexcept>
 
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BLURHASH_X86_KERNELS
+#include <immintrin.h>
+// MinGW GCC doesn't align the stack to 32 bytes for AVX spills (GCC bug 54412).
+#if !defined(_WIN32)
+#define BLURHASH_AVX2_KERNEL
+#endif
+#endif
+
 #ifdef DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #if __has_include(<doctest.h>)
 #include <doctest.h>
 #else
 #include <doctest/doctest.h>
 #endif
+#include <chrono>
+#include <random>
 #endif
 
 using namespace std::literals;
@@ -124,6 +135,15 @@ srgbToLinear(int value) noexcept
         return srgbToLinearF(static_cast<float>(value) / 255.f);
 }
 
+// sRGB to linear conversion of every 8 bit value, used by the encoder instead of computing
+// std::pow for each channel of each pixel.
+const std::array<float, 256> srgbToLinearTable = []() {
+        std::array<float, 256> table{};
+        for (int i = 0; i < 256; i++)
+                table[i] = srgbToLinear(i);
+        return table;
+}();
+
 int
 linearToSrgb(float value) noexcept
 {
@@ -240,6 +260,199 @@ bases_for(size_t dimension, size_t components)
         }
         return bases;
 }
+
+// Encodes the accumulated factors of an image as a blurhash string.
+std::string
+encodeFactors(std::vector<Color> factors, size_t height, int components_x, int components_y)
+{
+        // scale by normalization. Half the scaling is done in the accumulation loop to prevent going
+        // too far outside the float range.
+        for (size_t i = 0; i < factors.size(); i++) {
+                float normalisation = (i == 0) ? 1 : 2;
+                float scale         = normalisation / static_cast<float>(height);
+                factors[i] *= scale;
+        }
+
+        assert(factors.size() > 0);
+
+        auto dc = factors.front();
+        factors.erase(factors.begin());
+
+        std::string h;
+
+        h += leftPad(encode83(packComponents({components_x, components_y})), 1);
+
+        float maximumValue;
+        if (!factors.empty()) {
+                float actualMaximumValue = 0;
+                for (auto ac : factors) {
+                        actualMaximumValue = std::max({
+                          std::abs(ac.r),
+                          std::abs(ac.g),
+                          std::abs(ac.b),
+                          actualMaximumValue,
+                        });
+                }
+
+                int quantisedMaximumValue = encodeMaxAC(actualMaximumValue);
+                maximumValue              = ((float)quantisedMaximumValue + 1) / 166;
+                h += leftPad(encode83(quantisedMaximumValue), 1);
+        } else {
+                maximumValue = 1;
+                h += leftPad(encode83(0), 1);
+        }
+
+        h += leftPad(encode83(encodeDC(dc)), 4);
+
+        for (auto ac : factors)
+                h += leftPad(encode83(encodeAC(ac, maximumValue)), 2);
+
+        return h;
+}
+
+// Row accumulation kernels. Each one computes the dot product of the planar r, g and b rows
+// with a row of the x basis. To get bit-identical results in every kernel all of them keep 8
+// partial sums per channel (lane i accumulates elements i, i + 8, ...), reduce them in the same
+// order and add the remaining elements sequentially.
+using RowKernel = void (*)(const float *r, const float *g, const float *b, const float *basis,
+                           size_t width, float *out);
+
+constexpr size_t KERNEL_LANES = 8;
+
+// Reduction of the 8 partial sums in the order used by the vector kernels.
+inline float
+reduceLanes(const float *a)
+{
+        const float s0 = a[0] + a[4], s1 = a[1] + a[5], s2 = a[2] + a[6], s3 = a[3] + a[7];
+        return (s0 + s2) + (s1 + s3);
+}
+
+void
+accumulateRowScalar(const float *r, const float *g, const float *b, const float *basis, size_t width,
+                    float *out)
+{
+        float accR[KERNEL_LANES]{}, accG[KERNEL_LANES]{}, accB[KERNEL_LANES]{};
+
+        const size_t blocks = width - width % KERNEL_LANES;
+        for (size_t x = 0; x < blocks; x += KERNEL_LANES) {
+                for (size_t i = 0; i < KERNEL_LANES; i++) {
+                        accR[i] += r[x + i] * basis[x + i];
+                        accG[i] += g[x + i] * basis[x + i];
+                        accB[i] += b[x + i] * basis[x + i];
+                }
+        }
+
+        out[0] = reduceLanes(accR);
+        out[1] = reduceLanes(accG);
+        out[2] = reduceLanes(accB);
+
+        for (size_t x = blocks; x < width; x++) {
+                out[0] += r[x] * basis[x];
+                out[1] += g[x] * basis[x];
+                out[2] += b[x] * basis[x];
+        }
+}
+
+#ifdef BLURHASH_X86_KERNELS
+// Reduction of the partial sums in two 4 lanes registers, lanes 0-3 and 4-7.
+__attribute__((target("sse2"))) inline float
+reduceLanesSSE2(__m128 low, __m128 high)
+{
+        const __m128 s = _mm_add_ps(low, high);               // s0 s1 s2 s3
+        const __m128 t = _mm_add_ps(s, _mm_movehl_ps(s, s));  // s0+s2 s1+s3
+        return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, 1)));
+}
+
+__attribute__((target("sse2"))) void
+accumulateRowSSE2(const float *r, const float *g, const float *b, const float *basis, size_t width,
+                  float *out)
+{
+        __m128 accRl = _mm_setzero_ps(), accRh = _mm_setzero_ps();
+        __m128 accGl = _mm_setzero_ps(), accGh = _mm_setzero_ps();
+        __m128 accBl = _mm_setzero_ps(), accBh = _mm_setzero_ps();
+
+        const size_t blocks = width - width % KERNEL_LANES;
+        for (size_t x = 0; x < blocks; x += KERNEL_LANES) {
+                const __m128 bl = _mm_loadu_ps(basis + x);
+                const __m128 bh = _mm_loadu_ps(basis + x + 4);
+                accRl = _mm_add_ps(accRl, _mm_mul_ps(_mm_loadu_ps(r + x), bl));
+                accRh = _mm_add_ps(accRh, _mm_mul_ps(_mm_loadu_ps(r + x + 4), bh));
+                accGl = _mm_add_ps(accGl, _mm_mul_ps(_mm_loadu_ps(g + x), bl));
+                accGh = _mm_add_ps(accGh, _mm_mul_ps(_mm_loadu_ps(g + x + 4), bh));
+                accBl = _mm_add_ps(accBl, _mm_mul_ps(_mm_loadu_ps(b + x), bl));
+                accBh = _mm_add_ps(accBh, _mm_mul_ps(_mm_loadu_ps(b + x + 4), bh));
+        }
+
+        out[0] = reduceLanesSSE2(accRl, accRh);
+        out[1] = reduceLanesSSE2(accGl, accGh);
+        out[2] = reduceLanesSSE2(accBl, accBh);
+
+        for (size_t x = blocks; x < width; x++) {
+                out[0] += r[x] * basis[x];
+                out[1] += g[x] * basis[x];
+                out[2] += b[x] * basis[x];
+        }
+}
+
+#ifdef BLURHASH_AVX2_KERNEL
+__attribute__((target("avx2"))) inline float
+reduceLanesAVX2(__m256 acc)
+{
+        return reduceLanesSSE2(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+}
+
+// Multiplication and addition are kept separated (no FMA) to round like the other kernels.
+__attribute__((target("avx2"))) void
+accumulateRowAVX2(const float *r, const float *g, const float *b, const float *basis, size_t width,
+                  float *out)
+{
+        __m256 accR = _mm256_setzero_ps(), accG = _mm256_setzero_ps(), accB = _mm256_setzero_ps();
+
+        const size_t blocks = width - width % KERNEL_LANES;
+        for (size_t x = 0; x < blocks; x += KERNEL_LANES) {
+                const __m256 bv = _mm256_loadu_ps(basis + x);
+                accR = _mm256_add_ps(accR, _mm256_mul_ps(_mm256_loadu_ps(r + x), bv));
+                accG = _mm256_add_ps(accG, _mm256_mul_ps(_mm256_loadu_ps(g + x), bv));
+                accB = _mm256_add_ps(accB, _mm256_mul_ps(_mm256_loadu_ps(b + x), bv));
+        }
+
+        out[0] = reduceLanesAVX2(accR);
+        out[1] = reduceLanesAVX2(accG);
+        out[2] = reduceLanesAVX2(accB);
+
+        for (size_t x = blocks; x < width; x++) {
+                out[0] += r[x] * basis[x];
+                out[1] += g[x] * basis[x];
+                out[2] += b[x] * basis[x];
+        }
+}
+#endif // BLURHASH_AVX2_KERNEL
+#endif // BLURHASH_X86_KERNELS
+
+RowKernel
+rowKernel(blurhash::Kernel kernel) noexcept
+{
+        if (kernel == blurhash::Kernel::Automatic)
+                kernel = blurhash::kernelAvailable(blurhash::Kernel::AVX2)   ? blurhash::Kernel::AVX2
+                         : blurhash::kernelAvailable(blurhash::Kernel::SSE2) ? blurhash::Kernel::SSE2
+                                                                             : blurhash::Kernel::Scalar;
+
+        if (!blurhash::kernelAvailable(kernel))
+                return accumulateRowScalar;
+
+        switch (kernel) {
+#ifdef BLURHASH_X86_KERNELS
+        case blurhash::Kernel::SSE2:
+                return accumulateRowSSE2;
+#endif
+#ifdef BLURHASH_AVX2_KERNEL
+        case blurhash::Kernel::AVX2:
+                return accumulateRowAVX2;
+#endif
+        default:
+                return accumulateRowScalar;
+        }
+}
 }
 
 namespace blurhash {
@@ -303,79 +516,87 @@ decode(std::string_view blurhash, size_t width, size_t height, size_t bytesPerPi
         return i;
 }
 
+bool
+kernelAvailable(Kernel kernel) noexcept
+{
+        switch (kernel) {
+        case Kernel::Automatic:
+        case Kernel::Scalar:
+                return true;
+#ifdef BLURHASH_X86_KERNELS
+        case Kernel::SSE2:
+                return __builtin_cpu_supports("sse2");
+#endif
+#ifdef BLURHASH_AVX2_KERNEL
+        case Kernel::AVX2:
+                return __builtin_cpu_supports("avx2");
+#endif
+        default:
+                return false;
+        }
+}
+
 std::string
 encode(unsigned char *image, size_t width, size_t height, int components_x, int components_y)
+{
+        return encode(image, width, height, components_x, components_y, Kernel::Automatic);
+}
+
+std::string
+encode(unsigned char *image,
+       size_t width,
+       size_t height,
+       int components_x,
+       int components_y,
+       Kernel kernel)
 {
         if (width < 1 || height < 1 || components_x < 1 || components_x > 9 || components_y < 1 ||
             components_y > 9 || !image)
                 return "";
 
-        std::vector<float> basis_x = bases_for(width, components_x);
+        const auto accumulateRow = rowKernel(kernel);
+
+        // x basis transposed so each component is a contiguous row like the pixel values.
+        std::vector<float> basis_x(width * components_x);
+        {
+                const auto bases = bases_for(width, components_x);
+                for (size_t x = 0; x < width; x++)
+                        for (size_t nx = 0; nx < size_t(components_x); nx++)
+                                basis_x[nx * width + x] = bases[x * components_x + nx];
+        }
         std::vector<float> basis_y = bases_for(height, components_y);
 
+        // The basis is separable: for each row, first accumulate the pixels weighted by the x basis
+        // and then add the row sums weighted by the y basis to the factors. The result is the same as
+        // weighting each pixel by basis_x * basis_y but with components_x multiplications per pixel
+        // instead of components_x * components_y. Rows are converted to planar r, g and b linear
+        // values for the accumulation kernels.
         std::vector<Color> factors(components_x * components_y, Color{});
+        std::vector<Color> rowFactors(components_x, Color{});
+        std::vector<float> planar(width * 3);
+        float *r = planar.data(), *g = r + width, *b = g + width;
+        const float normalisation = 1.f / static_cast<float>(width);
         for (size_t y = 0; y < height; y++) {
-                for (size_t x = 0; x < width; x++) {
-                        Color linear{srgbToLinear(image[3 * x + 0 + y * width * 3]),
-                                     srgbToLinear(image[3 * x + 1 + y * width * 3]),
-                                     srgbToLinear(image[3 * x + 2 + y * width * 3])};
+                const unsigned char *row = image + y * width * 3;
 
-                        // other half of normalization.
-                        linear *= 1.f / static_cast<float>(width);
-
-                        for (size_t ny = 0; ny < size_t(components_y); ny++) {
-                                for (size_t nx = 0; nx < size_t(components_x); nx++) {
-                                        float basis = basis_x[x * size_t(components_x) + nx] *
-                                                      basis_y[y * size_t(components_y) + ny];
-                                        factors[ny * components_x + nx] += linear * basis;
-                                }
-                        }
+                // other half of normalization.
+                for (size_t x = 0; x < width; x++) {
+                        r[x] = srgbToLinearTable[row[3 * x + 0]] * normalisation;
+                        g[x] = srgbToLinearTable[row[3 * x + 1]] * normalisation;
+                        b[x] = srgbToLinearTable[row[3 * x + 2]] * normalisation;
                 }
-        }
 
-        // scale by normalization. Half the scaling is done in the previous loop to prevent going
-        // too far outside the float range.
-        for (size_t i = 0; i < factors.size(); i++) {
-                float normalisation = (i == 0) ? 1 : 2;
-                float scale         = normalisation / static_cast<float>(height);
-                factors[i] *= scale;
-        }
-
-        assert(factors.size() > 0);
-
-        auto dc = factors.front();
-        factors.erase(factors.begin());
+                for (size_t nx = 0; nx < size_t(components_x); nx++)
+                        accumulateRow(r, g, b, &basis_x[nx * width], width, &rowFactors[nx].r);
 
-        std::string h;
-
-        h += leftPad(encode83(packComponents({components_x, components_y})), 1);
-
-        float maximumValue;
-        if (!factors.empty()) {
-                float actualMaximumValue = 0;
-                for (auto ac : factors) {
-                        actualMaximumValue = std::max({
-                          std::abs(ac.r),
-                          std::abs(ac.g),
-                          std::abs(ac.b),
-                          actualMaximumValue,
-                        });
+                const float *basis = &basis_y[y * size_t(components_y)];
+                for (size_t ny = 0; ny < size_t(components_y); ny++) {
+                        for (size_t nx = 0; nx < size_t(components_x); nx++)
+                                factors[ny * components_x + nx] += rowFactors[nx] * basis[ny];
                 }
-
-                int quantisedMaximumValue = encodeMaxAC(actualMaximumValue);
-                maximumValue              = ((float)quantisedMaximumValue + 1) / 166;
-                h += leftPad(encode83(quantisedMaximumValue), 1);
-        } else {
-                maximumValue = 1;
-                h += leftPad(encode83(0), 1);
         }
 
-        h += leftPad(encode83(encodeDC(dc)), 4);
-
-        for (auto ac : factors)
-                h += leftPad(encode83(encodeAC(ac, maximumValue)), 2);
-
-        return h;
+        return encodeFactors(std::move(factors), height, components_x, components_y);
 }
 }
 
@@ -491,4 +712,134 @@ TEST_CASE("encode")
         CHECK(blurhash::encode(black.data(), 360, 200, 4, 0) == "");
         CHECK(blurhash::encode(black.data(), 360, 200, 4, 3) == "L00000fQfQfQfQfQfQfQfQfQfQfQ");
 }
+
+// Original per pixel encoder, used as reference for the results and timings of the encoder.
+std::string
+encodeReference(unsigned char *image, size_t width, size_t height, int components_x, int components_y)
+{
+        std::vector<float> basis_x = bases_for(width, components_x);
+        std::vector<float> basis_y = bases_for(height, components_y);
+
+        std::vector<Color> factors(components_x * components_y, Color{});
+        for (size_t y = 0; y < height; y++) {
+                for (size_t x = 0; x < width; x++) {
+                        Color linear{srgbToLinear(image[3 * x + 0 + y * width * 3]),
+                                     srgbToLinear(image[3 * x + 1 + y * width * 3]),
+                                     srgbToLinear(image[3 * x + 2 + y * width * 3])};
+
+                        linear *= 1.f / static_cast<float>(width);
+
+                        for (size_t ny = 0; ny < size_t(components_y); ny++) {
+                                for (size_t nx = 0; nx < size_t(components_x); nx++) {
+                                        float basis = basis_x[x * size_t(components_x) + nx] *
+                                                      basis_y[y * size_t(components_y) + ny];
+                                        factors[ny * components_x + nx] += linear * basis;
+                                }
+                        }
+                }
+        }
+
+        return encodeFactors(std::move(factors), height, components_x, components_y);
+}
+
+// Synthetic cover: smooth gradients, a few shapes and some noise.
+std::vector<unsigned char>
+syntheticCover(size_t width, size_t height, unsigned int seed)
+{
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<int> noise(-12, 12);
+        std::uniform_real_distribution<float> center(0.2f, 0.8f);
+        const float cx = center(generator) * width, cy = center(generator) * height;
+
+        std::vector<unsigned char> image(width * height * 3);
+        for (size_t y = 0; y < height; y++) {
+                for (size_t x = 0; x < width; x++) {
+                        const float d  = std::hypot(x - cx, y - cy) / static_cast<float>(width);
+                        const int r    = int(255.f * x / width) + noise(generator);
+                        const int g    = int(255.f * y / height) + noise(generator);
+                        const int b    = (d < 0.25f ? 220 : 40) + noise(generator);
+                        auto pixel     = &image[3 * (y * width + x)];
+                        pixel[0]       = static_cast<unsigned char>(std::clamp(r, 0, 255));
+                        pixel[1]       = static_cast<unsigned char>(std::clamp(g, 0, 255));
+                        pixel[2]       = static_cast<unsigned char>(std::clamp(b, 0, 255));
+                }
+        }
+        return image;
+}
+
+TEST_CASE("encode matches reference encoder")
+{
+        for (unsigned int seed = 0; seed < 16; seed++) {
+                const size_t width  = 64 + seed * 37;
+                const size_t height = 48 + seed * 23;
+                auto image          = syntheticCover(width, height, seed);
+                for (int components = 1; components <= 9; components += 2)
+                        CHECK(blurhash::encode(image.data(), width, height, components, 9 - components + 1) ==
+                              encodeReference(image.data(), width, height, components, 9 - components + 1));
+        }
+}
+
+TEST_CASE("encode kernels produce identical hashes")
+{
+        using blurhash::Kernel;
+
+        CHECK(blurhash::kernelAvailable(Kernel::Scalar));
+
+        for (unsigned int seed = 0; seed < 24; seed++) {
+                // Widths not multiple of the kernel lanes to check the remaining elements.
+                const size_t width  = 1 + seed * 29;
+                const size_t height = 1 + seed * 17;
+                auto image          = syntheticCover(width, height, seed);
+
+                for (auto components : {std::pair{4, 3}, std::pair{5, 5}, std::pair{9, 9}, std::pair{1, 1}}) {
+                        const auto scalar = blurhash::encode(
+                          image.data(), width, height, components.first, components.second, Kernel::Scalar);
+
+                        for (auto kernel : {Kernel::SSE2, Kernel::AVX2, Kernel::Automatic}) {
+                                if (!blurhash::kernelAvailable(kernel))
+                                        continue;
+                                CHECK(blurhash::encode(image.data(),
+                                                       width,
+                                                       height,
+                                                       components.first,
+                                                       components.second,
+                                                       kernel) == scalar);
+                        }
+                }
+        }
+}
+
+TEST_CASE("encode benchmark")
+{
+        using namespace std::chrono;
+
+        for (size_t size : {256, 1024, 4000}) {
+                auto image = syntheticCover(size, size, static_cast<unsigned int>(size));
+
+                auto start       = steady_clock::now();
+                const auto fast  = blurhash::encode(image.data(), size, size, 5, 5);
+                const auto fastT = duration<double, std::milli>(steady_clock::now() - start).count();
+
+                start            = steady_clock::now();
+                const auto ref   = encodeReference(image.data(), size, size, 5, 5);
+                const auto refT  = duration<double, std::milli>(steady_clock::now() - start).count();
+
+                // The reference encoder accumulates every pixel in a single float, with millions of
+                // pixels it loses precision and the results can differ in the last quantization step.
+                if (size <= 1024)
+                        CHECK(fast == ref);
+                MESSAGE(size << "x" << size << ": reference " << refT << " ms, encode " << fastT
+                             << " ms, speedup " << refT / fastT << "x");
+
+                for (auto kernel : {blurhash::Kernel::Scalar, blurhash::Kernel::SSE2, blurhash::Kernel::AVX2}) {
+                        if (!blurhash::kernelAvailable(kernel))
+                                continue;
+
+                        start = steady_clock::now();
+                        blurhash::encode(image.data(), size, size, 5, 5, kernel);
+                        const auto kernelT = duration<double, std::milli>(steady_clock::now() - start).count();
+                        MESSAGE("  kernel " << static_cast<int>(kernel) << ": " << kernelT << " ms");
+                }
+        }
+}
 #endif
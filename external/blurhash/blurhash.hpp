@@ -15,8 +15,26 @@ struct Image
 Image
 decode(std::string_view blurhash, size_t width, size_t height, size_t bytesPerPixel = 3) noexcept;
 
+// Kernels used to accumulate the pixel values in the encoder. Automatic selects the fastest one
+// available in the machine, all of them produce the same blurhash.
+enum class Kernel
+{
+        Automatic,
+        Scalar,
+        SSE2,
+        AVX2,
+};
+
+// Returns true if the given kernel can be used in the machine.
+bool
+kernelAvailable(Kernel kernel) noexcept;
+
 // Encode an image of rgb pixels (without padding) with size width*height into a blurhash with x*y
 // components
 std::string
 encode(unsigned char *image, size_t width, size_t height, int x, int y);
+
+// Encode using the given kernel, the scalar one is used if the kernel is not available.
+std::string
+encode(unsigned char *image, size_t width, size_t height, int x, int y, Kernel kernel);
 }